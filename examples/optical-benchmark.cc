@@ -0,0 +1,742 @@
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/quantum-network-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+
+/*
+Self timed microbenchmarks for the optical data plane. Each benchmark calls
+one hot path of OpticalDevice directly on a small switch with two endpoints
+and prints a csv line of the form
+
+	Benchmark,<name>,<iterations>,<ns per call>
+
+so runs can be compared between commits. Every Receive call is the handler
+of one simulator event, so 1e9 / <ns per call> is its events per second.
+The events a call schedules are run untimed between batches of calls, so
+the event queue and the device state stay as small as in a simulation.
+Delivery runs print
+
+	Allocations,<name>,<delivered>,<heap allocations per delivered message>
+*/
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("OPTICAL_BENCHMARK");
+
+volatile uint64_t benchmark_sink = 0;
+uint64_t benchmark_delivered = 0;
+std::atomic<uint64_t> heap_allocations(0);
+
+/*
+Count every heap allocation of this benchmark, the module libraries
+included. The simulations keep the default operator new.
+*/
+void*
+operator new(std::size_t size)
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void
+operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+/*
+The byte decoding OpticalDevice used before the shared codec, kept here as
+the baseline for the ControlPayload/decode-legacy benchmark.
+*/
+uint16_t
+LegacyBytesToUint16(uint8_t* buffer, int offset)
+{
+	NS_LOG_FUNCTION(buffer << offset);
+	uint16_t low = static_cast<uint16_t>(buffer[offset]);
+	uint16_t high = static_cast<uint16_t>(buffer[offset + 1]);
+	uint16_t value = high << 8 | low;
+	return value;
+}
+
+uint32_t
+LegacyBytesToUint32(uint8_t* buffer, int offset)
+{
+	NS_LOG_FUNCTION(buffer << offset);
+	uint32_t low = static_cast<uint32_t>(LegacyBytesToUint16(buffer, offset));
+	uint32_t high = 
+		static_cast<uint32_t>(LegacyBytesToUint16(buffer, offset + 2));
+	uint32_t value = high << 16 | low;
+	return value;
+}
+
+uint64_t
+LegacyBytesToUint64(uint8_t* buffer, int offset)
+{
+	NS_LOG_FUNCTION(buffer << offset);
+	uint64_t low = static_cast<uint64_t>(LegacyBytesToUint32(buffer, offset));
+	uint64_t high = 
+		static_cast<uint64_t>(LegacyBytesToUint32(buffer, offset + 4));
+	uint64_t value = high << 32 | low;
+	return value;
+}
+
+namespace ns3
+{
+	class OpticalBenchmark
+	{
+		public:
+			OpticalBenchmark(uint32_t iterations, uint8_t channels);
+			void Run();
+		private:
+			template <typename F>
+			void Measure(const std::string& name, uint32_t iterations, F body);
+			template <typename F, typename D>
+			void Measure(const std::string& name, uint32_t iterations, 
+						 uint32_t batch, F body, D drain);
+			OpticalHelper CreateHelper() const;
+			void Setup();
+			void Teardown();
+			void Drain();
+			void Announce(uint32_t first, uint32_t count);
+			Ptr<Packet> CreateDataPacket(uint32_t id, uint8_t channel,
+										 Ipv4Address source, Ipv4Address dest);
+			Ptr<Packet> CreateControlPacket(uint32_t id, uint8_t msg_type);
+			void BenchScheduleMessage(uint32_t occupancy);
+			void BenchFreeChannels(uint32_t occupancy);
+			void BenchGetPacketTransmitTime();
+			void BenchSplitPacket();
+			void BenchControlHeader();
+			void BenchControlPayload();
+			void BenchEndpointReceive();
+			void BenchSwitchReceive();
+			void BenchSlotLookup();
+			void BenchTraceSinks(bool sinks);
+			void BenchAllocations(bool pooling);
+
+			uint32_t m_iterations;
+			uint8_t m_channels;
+			NodeContainer m_nodes;
+			Ptr<OpticalDevice> m_endpoint;
+			Ptr<OpticalDevice> m_switch_in;
+			Ptr<OpticalDevice> m_switch_out;
+			Ipv4Address m_endpoint_address;
+			Ipv4Address m_remote_address;
+			Ptr<Socket> m_sink;
+			Time m_slot;
+	};
+
+	// Receive calls timed between two drains of the simulator
+	const uint32_t BENCHMARK_BATCH = 64;
+
+	static void
+	SendMessage(Ptr<Socket> socket, Address dest)
+	{
+		uint8_t payload[16] = {};
+		socket->SendTo(payload, sizeof(payload), 0, dest);
+	}
+
+	static void
+	CountDelivered(Ptr<Socket> socket)
+	{
+		while (socket->Recv())
+		{
+			benchmark_delivered++;
+		}
+	}
+
+	OpticalBenchmark::OpticalBenchmark(uint32_t iterations, uint8_t channels)
+		: m_iterations(iterations),
+		  m_channels(channels)
+	{
+	}
+
+	template <typename F>
+	void
+	OpticalBenchmark::Measure(const std::string& name, uint32_t iterations,
+							  F body)
+	{
+		Measure(name, iterations, iterations, body, [](uint32_t next) {});
+	}
+
+	/*
+	Time body(i) for every i in batches, calling drain(next) untimed after
+	each batch with the index of the next call.
+	*/
+	template <typename F, typename D>
+	void
+	OpticalBenchmark::Measure(const std::string& name, uint32_t iterations,
+							  uint32_t batch, F body, D drain)
+	{
+		double nanos = 0;
+		for (uint32_t i = 0; i < iterations; i += batch)
+		{
+			uint32_t end = std::min(iterations, i + batch);
+			auto start = std::chrono::steady_clock::now();
+			for (uint32_t j = i; j < end; j++)
+			{
+				body(j);
+			}
+			auto stop = std::chrono::steady_clock::now();
+			nanos += std::chrono::duration<double, std::nano>(
+				stop - start).count();
+			drain(end);
+		}
+		std::cout << "Benchmark," << name << "," << iterations << ","
+				  << nanos / iterations << std::endl;
+	}
+
+	OpticalHelper
+	OpticalBenchmark::CreateHelper() const
+	{
+		OpticalHelper helper;
+		helper.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1024p"));
+		helper.SetDeviceAttribute("ControlDataRate",
+			DataRateValue(DataRate("40Gbps")));
+		helper.SetDeviceAttribute("DataDataRate",
+			DataRateValue(DataRate("40Gbps")));
+		helper.SetDeviceAttribute("ControlFrameGap", TimeValue(NanoSeconds(5)));
+		helper.SetDeviceAttribute("DataFrameGap", TimeValue(NanoSeconds(5)));
+		helper.SetDeviceAttribute("PacketDelay", TimeValue(NanoSeconds(738)));
+		helper.SetDeviceAttribute("SwitchPropagationDelay",
+			TimeValue(NanoSeconds(2)));
+		helper.SetDeviceAttribute("TotalPropagationDelay",
+			TimeValue(NanoSeconds(12)));
+		helper.SetDeviceAttribute("ReconfigureTime",
+			TimeValue(NanoSeconds(500)));
+		helper.SetDeviceAttribute("TimeslotDuration",
+			TimeValue(MicroSeconds(10)));
+		helper.SetDeviceAttribute("PacketProcessing",
+			TimeValue(NanoSeconds(350)));
+		helper.SetDeviceAttribute("OpticalProcessing",
+			TimeValue(NanoSeconds(350)));
+		// Every delivered id is new, keep the collision history short
+		helper.SetDeviceAttribute("MaxReceivedHistory", UintegerValue(16));
+		helper.SetChannelAttribute("Delay", TimeValue(NanoSeconds(5)));
+		helper.SetChannelAttribute("NumChannels", UintegerValue(m_channels));
+		return helper;
+	}
+
+	void
+	OpticalBenchmark::Setup()
+	{
+		m_nodes = NodeContainer();
+		for (int i = 0; i < 3; i++)
+		{
+			Ptr<TimeNode> node = CreateObject<TimeNode>();
+			node->SetAttribute("Skew", DoubleValue(0));
+			m_nodes.Add(node);
+		}
+
+		OpticalHelper helper = CreateHelper();
+		NetDeviceContainer in = helper.Install(m_nodes.Get(1), m_nodes.Get(0));
+		NetDeviceContainer out = helper.Install(m_nodes.Get(2), m_nodes.Get(0));
+		// The events run by Drain hand packets to the ip stack
+		InternetStackHelper stack;
+		stack.Install(m_nodes);
+		Ipv4AddressHelper address;
+		address.SetBase("10.1.1.0", "255.255.255.0");
+		Ipv4InterfaceContainer in_interfaces = address.Assign(in);
+		address.SetBase("10.1.2.0", "255.255.255.0");
+		Ipv4InterfaceContainer out_interfaces = address.Assign(out);
+		NodeContainer ends(m_nodes.Get(1), m_nodes.Get(2));
+		helper.SetEndpoints(ends);
+		Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+		helper.Initialize(m_nodes);
+
+		m_endpoint = DynamicCast<OpticalDevice>(in.Get(0));
+		m_switch_in = DynamicCast<OpticalDevice>(in.Get(1));
+		m_switch_out = DynamicCast<OpticalDevice>(out.Get(1));
+		m_endpoint_address = in_interfaces.GetAddress(0);
+		m_remote_address = out_interfaces.GetAddress(0);
+		m_slot = m_switch_in->GetSlotClock()->GetSlotStart(0);
+
+		// Takes the data delivered to the endpoint
+		TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+		m_sink = Socket::CreateSocket(m_nodes.Get(1), tid);
+		m_sink->Bind(InetSocketAddress(m_endpoint_address, 80));
+		m_sink->SetRecvCallback(MakeCallback(&CountDelivered));
+	}
+
+	void
+	OpticalBenchmark::Teardown()
+	{
+		m_endpoint = nullptr;
+		m_switch_in = nullptr;
+		m_switch_out = nullptr;
+		m_sink = nullptr;
+		m_nodes = NodeContainer();
+		Simulator::Destroy();
+	}
+
+	void
+	OpticalBenchmark::Drain()
+	{
+		Simulator::Run();
+		// Running the events moves the clocks on, the switch benchmarks
+		// need it back in the data window of the bound slot
+		DynamicCast<TimeNode>(m_switch_in->GetNode())->SetLocalTime(m_slot);
+	}
+
+	/*
+	Deliver the reservations of count ids from first to the endpoint, so
+	their data is expected.
+	*/
+	void
+	OpticalBenchmark::Announce(uint32_t first, uint32_t count)
+	{
+		for (uint32_t id = first; id < first + count; id++)
+		{
+			m_endpoint->Receive(CreateControlPacket(id, 1));
+		}
+		Drain();
+	}
+
+	Ptr<Packet>
+	OpticalBenchmark::CreateDataPacket(uint32_t id, uint8_t channel,
+									   Ipv4Address source, Ipv4Address dest)
+	{
+		Ptr<Packet> p = Create<Packet>(64);
+		UdpHeader udp_header;
+		udp_header.SetSourcePort(80);
+		udp_header.SetDestinationPort(80);
+		p->AddHeader(udp_header);
+		Ipv4Header ipv4_header;
+		ipv4_header.SetSource(source);
+		ipv4_header.SetDestination(dest);
+		ipv4_header.SetProtocol(UdpL4Protocol::PROT_NUMBER);
+		ipv4_header.SetTtl(64);
+		ipv4_header.SetPayloadSize(72);
+		p->AddHeader(ipv4_header);
+		OpticalHeader header;
+		header.SetProtocol(0x0800);
+		header.SetTimestamp(0);
+		header.SetMsgId(id);
+		p->AddHeader(header);
+		OpticalTag tag;
+		tag.SetChannel(channel);
+		tag.SetMsgId(id);
+		p->AddPacketTag(tag);
+		return p;
+	}
+
+	Ptr<Packet>
+	OpticalBenchmark::CreateControlPacket(uint32_t id, uint8_t msg_type)
+	{
+		uint8_t buffer[26] = {};
+		buffer[0] = msg_type;
+		codec::StoreUint32(buffer, 1, id);
+		Ptr<Packet> p = Create<Packet>(buffer, 26);
+		UdpHeader udp_header;
+		p->AddHeader(udp_header);
+		Ipv4Header ipv4_header;
+		ipv4_header.SetSource(m_remote_address);
+		ipv4_header.SetDestination(m_endpoint_address);
+		ipv4_header.SetPayloadSize(34);
+		p->AddHeader(ipv4_header);
+		OpticalHeader header;
+		header.SetProtocol(0x0800);
+		header.SetTimestamp(0);
+		header.SetMsgId(id);
+		p->AddHeader(header);
+		OpticalTag tag;
+		tag.SetChannel(0);
+		tag.SetMsgId(id);
+		p->AddPacketTag(tag);
+		return p;
+	}
+
+	void
+	OpticalBenchmark::BenchScheduleMessage(uint32_t occupancy)
+	{
+		Setup();
+		Ptr<OpticalSlotClock> clock = m_switch_in->GetSlotClock();
+		Time slot = m_slot;
+		Time tx_delay = NanoSeconds(100);
+		Time spacing = NanoSeconds(110);
+		Address dest = m_switch_out->GetRemote();
+		int from = m_switch_in->GetIfIndex();
+		for (uint32_t i = 0; i < occupancy; i++)
+		{
+			m_switch_out->ScheduleMessage(slot + spacing * i, dest, i, 1,
+										  tx_delay, from);
+		}
+		// Overlaps the last reservation so every call scans the full list
+		Time arrival = occupancy > 0 ? slot + spacing * (occupancy - 1) : slot;
+		bool admitted = occupancy == 0;
+		Measure("ScheduleMessage/occupancy=" + std::to_string(occupancy),
+				m_iterations,
+				[&](uint32_t i) {
+					bool result = m_switch_out->ScheduleMessage(arrival, dest,
+						occupancy + i, 1, tx_delay, from);
+					if (result)
+					{
+						// Keep occupancy constant when the call admits
+						OpticalSlotClock::Slot* bound = clock->Find(slot);
+						bound->RemoveBurst(from, 1, occupancy + i);
+						bound->RemoveBurst(m_switch_out->GetIfIndex(), 1,
+										   occupancy + i);
+					}
+					NS_ASSERT_MSG(result == admitted,
+								  "Unexpected admission result.");
+				});
+		Teardown();
+	}
+
+	void
+	OpticalBenchmark::BenchFreeChannels(uint32_t occupancy)
+	{
+		Setup();
+		Ptr<OpticalSlotClock> clock = m_switch_in->GetSlotClock();
+		Time slot = m_slot;
+		Time tx_delay = NanoSeconds(100);
+		Time spacing = NanoSeconds(110);
+		Address dest = m_switch_out->GetRemote();
+		int from = m_switch_in->GetIfIndex();
+		int to = m_switch_out->GetIfIndex();
+		for (uint8_t c = 1; c <= m_channels; c++)
+		{
+			for (uint32_t i = 0; i < occupancy; i++)
+			{
+				m_switch_out->ScheduleMessage(slot + spacing * i, dest, 
+					c * occupancy + i, c, tx_delay, from);
+			}
+		}
+		Time arrival = occupancy > 0 ? slot + spacing * (occupancy - 1) : slot;
+		std::string suffix = "/occupancy=" + std::to_string(occupancy);
+		Measure("FreeChannels/mask" + suffix, m_iterations,
+				[&](uint32_t i) {
+					uint64_t free = m_switch_out->GetFreeChannels(arrival, 
+						dest, tx_delay, from);
+					NS_ASSERT_MSG((free == 0) == (occupancy > 0),
+								  "Unexpected free channels.");
+				});
+		// One overlap trial per channel, the search the mask replaces
+		const OpticalSlotClock::Slot* bound = clock->Find(slot);
+		int64_t a2 = arrival.GetTimeStep();
+		int64_t e2 = (arrival + tx_delay).GetTimeStep();
+		Measure("FreeChannels/trials" + suffix, m_iterations,
+				[&](uint32_t i) {
+					uint64_t free = 0;
+					for (uint8_t c = 1; bound && c <= m_channels; c++)
+					{
+						bool busy = bound->Overlaps(from, c, a2, e2) ||
+									bound->Overlaps(to, c, a2, e2);
+						free |= static_cast<uint64_t>(!busy) << c;
+					}
+					NS_ASSERT_MSG(!bound || (free == 0) == (occupancy > 0),
+								  "Unexpected free channels.");
+				});
+		Teardown();
+	}
+
+	void
+	OpticalBenchmark::BenchGetPacketTransmitTime()
+	{
+		Setup();
+		Time tx_ctrl = NanoSeconds(14);
+		Time tx_data = NanoSeconds(30);
+		// Each call queues behind the last, so the bursts walk through
+		// every part of the timeslots
+		Measure("GetPacketTransmitTime", m_iterations,
+				[&](uint32_t i) {
+					m_endpoint->GetPacketTransmitTime(tx_ctrl, tx_data, 1);
+				});
+		Teardown();
+	}
+
+	void
+	OpticalBenchmark::BenchSplitPacket()
+	{
+		Setup();
+		Ptr<Packet> original = Create<Packet>(64);
+		UdpHeader udp_header;
+		original->AddHeader(udp_header);
+		Ipv4Header ipv4_header;
+		ipv4_header.SetSource(m_endpoint_address);
+		ipv4_header.SetDestination(m_remote_address);
+		ipv4_header.SetPayloadSize(72);
+		original->AddHeader(ipv4_header);
+		Measure("SplitPacket", m_iterations,
+				[&](uint32_t i) {
+					Ptr<Packet> data = original->Copy();
+					Ptr<Packet> control;
+					m_endpoint->SplitPacket(data, control, 0x0800, i);
+				});
+		Teardown();
+	}
+
+	void
+	OpticalBenchmark::BenchControlHeader()
+	{
+		OpticalControlHeader header;
+		header.SetMsgId(1);
+		header.SetSendTimestamp(1000);
+		header.SetMessageTimestamp(2000);
+		header.SetChannel(1);
+		header.SetProtocol(0x0800);
+		header.SetDuration(30);
+		Measure("OpticalControlHeader/encode+decode", m_iterations,
+				[&](uint32_t i) {
+					Ptr<Packet> p = Create<Packet>();
+					header.SetMsgId(i);
+					p->AddHeader(header);
+					OpticalControlHeader read;
+					p->RemoveHeader(read);
+					NS_ASSERT_MSG(read.GetMsgId() == i, "Decode mismatch.");
+				});
+	}
+
+	void
+	OpticalBenchmark::BenchControlPayload()
+	{
+		Setup();
+		uint8_t buffer[26] = {};
+		uint64_t checksum = 0;
+		Measure("ControlPayload/encode", m_iterations,
+				[&](uint32_t i) {
+					buffer[0] = 1;
+					codec::StoreUint32(buffer, 1, i);
+					codec::StoreUint64(buffer, 5, i);
+					codec::StoreUint64(buffer, 13, 30);
+					buffer[21] = 1;
+					codec::StoreUint32(buffer, 22, 1);
+					checksum += buffer[1];
+				});
+		Measure("ControlPayload/decode-legacy", m_iterations,
+				[&](uint32_t i) {
+					checksum += LegacyBytesToUint32(buffer, 1);
+					checksum += LegacyBytesToUint64(buffer, 5);
+					checksum += LegacyBytesToUint64(buffer, 13);
+					checksum += LegacyBytesToUint32(buffer, 22);
+				});
+		Measure("ControlPayload/decode", m_iterations,
+				[&](uint32_t i) {
+					checksum += codec::LoadUint32(buffer, 1);
+					checksum += codec::LoadUint64(buffer, 5);
+					checksum += codec::LoadUint64(buffer, 13);
+					checksum += codec::LoadUint32(buffer, 22);
+				});
+		benchmark_sink = checksum;
+		Teardown();
+	}
+
+	void
+	OpticalBenchmark::BenchEndpointReceive()
+	{
+		Setup();
+		Ptr<Packet> control = CreateControlPacket(0, 1);
+		Measure("Receive/endpoint/control", m_iterations, BENCHMARK_BATCH,
+				[&](uint32_t i) {
+					m_endpoint->Receive(control->Copy());
+				},
+				[&](uint32_t next) {
+					Drain();
+				});
+		// A few bursts in flight, each announced before its data arrives
+		uint32_t batch = 16;
+		Announce(1, batch);
+		Measure("Receive/endpoint/data", m_iterations, batch,
+				[&](uint32_t i) {
+					m_endpoint->Receive(CreateDataPacket(i + 1, 1, 
+						m_remote_address, m_endpoint_address));
+				},
+				[&](uint32_t next) {
+					Drain();
+					Announce(next + 1, batch);
+				});
+		Teardown();
+	}
+
+	void
+	OpticalBenchmark::BenchSwitchReceive()
+	{
+		Setup();
+		Address dest = m_switch_out->GetRemote();
+		int from = m_switch_in->GetIfIndex();
+		bool bound = m_switch_out->ScheduleMessage(m_slot, dest, 1, 1,
+			NanoSeconds(100), from);
+		NS_ASSERT_MSG(bound, "Could not bind the benchmark route.");
+		// Move the switch clock into the data window of the bound slot
+		Drain();
+		Ptr<Packet> data = CreateDataPacket(1, 1, m_endpoint_address, 
+											m_remote_address);
+		// One call per drain, a second burst on the lane would collide
+		Measure("Receive/switch/data", m_iterations, 1,
+				[&](uint32_t i) {
+					m_switch_in->Receive(data->Copy());
+				},
+				[&](uint32_t next) {
+					Drain();
+				});
+		Teardown();
+	}
+
+	void
+	OpticalBenchmark::BenchSlotLookup()
+	{
+		Setup();
+		Ptr<OpticalSlotClock> clock = m_switch_in->GetSlotClock();
+		Time slot = m_slot;
+		Address dest = m_switch_out->GetRemote();
+		int from = m_switch_in->GetIfIndex();
+		m_switch_out->ScheduleMessage(slot, dest, 1, 1, NanoSeconds(100), 
+									  from);
+		DynamicCast<TimeNode>(m_switch_in->GetNode())->SetLocalTime(slot);
+		uint64_t checksum = 0;
+		Measure("SlotLookup/switch", m_iterations,
+				[&](uint32_t i) {
+					checksum += clock->IsReconfiguring(slot);
+					checksum += m_switch_in->GetOpticalRoute(1);
+				});
+		benchmark_sink = checksum;
+		Teardown();
+	}
+
+	static void
+	PacketSink(Ptr<const Packet> p)
+	{
+		benchmark_sink += p->GetSize();
+	}
+
+	void
+	OpticalBenchmark::BenchTraceSinks(bool sinks)
+	{
+		Setup();
+		std::string suffix = sinks ? "/sinks" : "/no-sinks";
+		if (sinks)
+		{
+			Ptr<OpticalDevice> devs[] = {m_endpoint, m_switch_in, m_switch_out};
+			for (Ptr<OpticalDevice> dev : devs)
+			{
+				dev->TraceConnectWithoutContext("RxTrace",
+					MakeCallback(&PacketSink));
+				dev->TraceConnectWithoutContext("TxTrace",
+					MakeCallback(&PacketSink));
+				dev->TraceConnectWithoutContext("DropTrace",
+					MakeCallback(&PacketSink));
+			}
+		}
+		Ptr<Packet> control = CreateControlPacket(0, 1);
+		Measure("Trace/endpoint/control" + suffix, m_iterations, 
+				BENCHMARK_BATCH,
+				[&](uint32_t i) {
+					m_endpoint->Receive(control->Copy());
+				},
+				[&](uint32_t next) {
+					Drain();
+				});
+		m_switch_out->ScheduleMessage(m_slot, m_switch_out->GetRemote(), 1, 1,
+			NanoSeconds(100), m_switch_in->GetIfIndex());
+		Drain();
+		Ptr<Packet> data = CreateDataPacket(1, 1, m_endpoint_address, 
+											m_remote_address);
+		Measure("Trace/switch/data" + suffix, m_iterations, 1,
+				[&](uint32_t i) {
+					m_switch_in->Receive(data->Copy());
+				},
+				[&](uint32_t next) {
+					Drain();
+				});
+		Teardown();
+	}
+
+	void
+	OpticalBenchmark::BenchAllocations(bool pooling)
+	{
+		// Nodes freed by the earlier benchmarks would serve the first
+		// bursts of the pooled run without a heap allocation
+		memory::ReleaseFreeLists();
+		memory::GetPoolingEnabled() = pooling;
+		Setup();
+		TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+		InetSocketAddress dest(m_remote_address, 80);
+		Ptr<Socket> rx = Socket::CreateSocket(m_nodes.Get(2), tid);
+		rx->Bind(dest);
+		rx->SetRecvCallback(MakeCallback(&CountDelivered));
+		Ptr<Socket> tx = Socket::CreateSocket(m_nodes.Get(1), tid);
+		// One message per timeslot, so none of them is refused
+		uint32_t messages = std::min<uint32_t>(m_iterations, 1000);
+		for (uint32_t i = 0; i < messages; i++)
+		{
+			Simulator::Schedule(MicroSeconds(11) * i + NanoSeconds(10),
+								&SendMessage, tx, dest);
+		}
+
+		benchmark_delivered = 0;
+		uint64_t before = heap_allocations.load(std::memory_order_relaxed);
+		Simulator::Run();
+		uint64_t allocations = 
+			heap_allocations.load(std::memory_order_relaxed) - before;
+		std::string name = pooling ? "delivery/pool" : "delivery/no-pool";
+		std::cout << "Allocations," << name << "," << benchmark_delivered 
+				  << ","
+				  << (benchmark_delivered > 0 ? 
+					  (double)allocations / benchmark_delivered : 0)
+				  << std::endl;
+		rx = nullptr;
+		tx = nullptr;
+		Teardown();
+		memory::GetPoolingEnabled() = true;
+	}
+
+	void
+	OpticalBenchmark::Run()
+	{
+		uint32_t occupancies[] = {0, 4, 16, 64};
+		for (uint32_t occupancy : occupancies)
+		{
+			BenchScheduleMessage(occupancy);
+		}
+		for (uint32_t occupancy : occupancies)
+		{
+			BenchFreeChannels(occupancy);
+		}
+		BenchGetPacketTransmitTime();
+		BenchSplitPacket();
+		BenchControlHeader();
+		BenchControlPayload();
+		BenchEndpointReceive();
+		BenchSwitchReceive();
+		BenchSlotLookup();
+		BenchTraceSinks(false);
+		BenchTraceSinks(true);
+		BenchAllocations(false);
+		BenchAllocations(true);
+	}
+}
+
+int
+main(int argc, char* argv[])
+{
+	uint32_t iterations = 100000;
+	uint32_t channels = 10;
+	CommandLine cmd(__FILE__);
+	cmd.AddValue("iterations", "Calls timed per benchmark.", iterations);
+	cmd.AddValue("num-channels", "The number of optical channels used.",
+				 channels);
+	cmd.Parse(argc, argv);
+
+	OpticalBenchmark bench(iterations, channels);
+	bench.Run();
+	return 0;
+}
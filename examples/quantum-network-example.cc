@@ -12,24 +12,6 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("QAUNTUM_NETWORK_EXAMPLE");
 
-uint16_t
-BytesToUint16(uint8_t* buffer, int offset)
-{
-	uint16_t low = static_cast<uint16_t>(buffer[offset]);
-	uint16_t high = static_cast<uint16_t>(buffer[offset + 1]);
-	uint16_t value = high << 8 | low;
-	return value;
-}
-
-uint32_t
-BytesToUint32(uint8_t* buffer, int offset)
-{
-	uint32_t low = static_cast<uint32_t>(BytesToUint16(buffer, offset));
-	uint32_t high = static_cast<uint32_t>(BytesToUint16(buffer, offset + 2));
-	uint32_t value = high << 16 | low;
-	return value;
-}
-
 void
 DropSink(std::string context, Ptr<const Packet> packet)
 {
@@ -45,7 +27,7 @@ DropSink(std::string context, Ptr<const Packet> packet)
 	NS_ASSERT_MSG(data_size > 5, "Invalid packet size.");
 	uint8_t *buffer = new uint8_t[data_size];
 	copy->CopyData(buffer, data_size); 
-	uint32_t id = BytesToUint32(buffer, 1);
+	uint32_t id = codec::LoadUint32(buffer, 1);
 	uint8_t protocol = buffer[5];
 	std::cout << "Dropped," << id << "," << (int)protocol << std::endl;
 	delete[] buffer;
@@ -69,7 +51,7 @@ CollisionSink(std::string context, Ptr<const OpticalDevice> device,
 	NS_ASSERT_MSG(data_size > 5, "Invalid packet size.");
 	uint8_t *buffer = new uint8_t[data_size];
 	copy->CopyData(buffer, data_size); 
-	uint32_t id = BytesToUint32(buffer, 1);
+	uint32_t id = codec::LoadUint32(buffer, 1);
 	uint8_t protocol = buffer[5];
 	std::cout << "Collision," << id << "," << (int)protocol << std::endl;
 	delete[] buffer;
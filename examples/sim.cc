@@ -7,9 +7,16 @@
 #include "ns3/internet-module.h"
 
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <string>
 #include <cmath>
+#include <chrono>
+#include <cstdlib>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace ns3;
 
@@ -17,24 +24,6 @@ int drop_count = 0;
 int collision_count = 0;
 NS_LOG_COMPONENT_DEFINE("QUANTUM_SIM");
 
-uint16_t
-BytesToUint16(uint8_t* buffer, int offset)
-{
-	uint16_t low = static_cast<uint16_t>(buffer[offset]);
-	uint16_t high = static_cast<uint16_t>(buffer[offset + 1]);
-	uint16_t value = high << 8 | low;
-	return value;
-}
-
-uint32_t
-BytesToUint32(uint8_t* buffer, int offset)
-{
-	uint32_t low = static_cast<uint32_t>(BytesToUint16(buffer, offset));
-	uint32_t high = static_cast<uint32_t>(BytesToUint16(buffer, offset + 2));
-	uint32_t value = high << 16 | low;
-	return value;
-}
-
 void
 DropSink(std::string context, Ptr<const Packet> packet)
 {
@@ -50,7 +39,7 @@ DropSink(std::string context, Ptr<const Packet> packet)
 	NS_ASSERT_MSG(data_size > 5, "Invalid packet size.");
 	uint8_t *buffer = new uint8_t[data_size];
 	copy->CopyData(buffer, data_size); 
-	uint32_t id = BytesToUint32(buffer, 1);
+	uint32_t id = codec::LoadUint32(buffer, 1);
 	uint8_t protocol = buffer[5];
 	std::cout << "Dropped," << id << "," << (int)protocol << std::endl;
 	delete[] buffer;
@@ -75,7 +64,7 @@ CollisionSink(std::string context, Ptr<const OpticalDevice> device,
 	NS_ASSERT_MSG(data_size > 5, "Invalid packet size.");
 	uint8_t *buffer = new uint8_t[data_size];
 	copy->CopyData(buffer, data_size); 
-	uint32_t id = BytesToUint32(buffer, 1);
+	uint32_t id = codec::LoadUint32(buffer, 1);
 	uint8_t protocol = buffer[5];
 	std::cout << "Collision," << id << "," << (int)protocol << std::endl;
 	delete[] buffer;
@@ -84,103 +73,242 @@ CollisionSink(std::string context, Ptr<const OpticalDevice> device,
 	collision_count++;
 }
 
-int
-main(int argc, char* argv[])
+void
+MemoryReport(Time interval)
 {
-	// Setup command line arguments
-	int num_qubits = 20;
-	float q_error = 0.5;
-	float c_error = 0.5;
-	int ave_send_time = 9000000;
-	int send_rng = 1000;
-	float skew = 0.0;
-	int reconfigure_time = 500;
-	int timeslot = 10000;
-	int packet_delay = 1000;
-    int max_tx_queue = 10000;
-	int num_channels = 10;
-	int debug = 0;
-	int nodes_per_switch = 2;
-	int cluster_size = 2;
-	int num_clusters = 2;
-	CommandLine cmd(__FILE__);
-	cmd.AddValue("qubits", "The number of qubits in QNIC.", num_qubits);
-	cmd.AddValue("qerror", "The error rate for quantum traffic.", q_error);
-	cmd.AddValue("cerror", "The error rate for classical traffic.", c_error);
-	cmd.AddValue("send-time", "The average time between messages.", 
-				 ave_send_time);
-	cmd.AddValue("send-range", "The range in time between send messages.",
-				 send_rng);
-	cmd.AddValue("skew", "The amount of skew clocks will have.", skew);
-	cmd.AddValue("reconfigure", "The reconfigure time of switches.", 
-				 reconfigure_time);
-	cmd.AddValue("timeslot", "The duration of the timeslot (ns).", timeslot);
-	cmd.AddValue("packet-delay", "Time between control and data.", packet_delay);
-	cmd.AddValue("max-tx-queue", "Maximum size of tx_queue before app closes.", 
-				 max_tx_queue);
-	cmd.AddValue("num-channels", "The number of optical channels used",
-				 num_channels);
-	cmd.AddValue("nodes-per-switch", "The number of nodes attached to a switch",
-				 nodes_per_switch);
-	cmd.AddValue("cluster-size", "Each cluster will have 2 * cluster-size "
-				 "switches and cluster-size * nodes-per-switch of nodes.",
-				 cluster_size);
-	cmd.AddValue("num-clusters", "The number of clusters.",
-				 num_clusters);
-	cmd.AddValue("debug", "Debug level 0-none, 1-app, 2-app+optical", debug);
-    cmd.Parse(argc, argv);
-
-	// Setup logging
-	if (debug > 0)
+	for (auto n = NodeList::Begin(); n != NodeList::End(); n++)
 	{
-		LogComponentEnable("QuantumApplication", LOG_LEVEL_ALL);
+		Ptr<Node> node = *n;
+		for (uint32_t i = 0; i < node->GetNDevices(); i++)
+		{
+			Ptr<OpticalDevice> dev = 
+				DynamicCast<OpticalDevice>(node->GetDevice(i));
+			if (!dev) continue;
+			for (const auto& item : dev->GetMemoryUsage())
+			{
+				std::cout << "Memory," << Simulator::Now().GetSeconds() 
+						  << ",device," << node->GetId() << "," << i << ","
+						  << item.first << "," << item.second << std::endl;
+			}
+		}
+		Ptr<OpticalSlotClock> clock = node->GetObject<OpticalSlotClock>();
+		if (clock)
+		{
+			for (const auto& item : clock->GetMemoryUsage())
+			{
+				std::cout << "Memory," << Simulator::Now().GetSeconds() 
+						  << ",clock," << node->GetId() << ",0,"
+						  << item.first << "," << item.second << std::endl;
+			}
+		}
+		for (uint32_t i = 0; i < node->GetNApplications(); i++)
+		{
+			Ptr<QuantumApplication> app = 
+				DynamicCast<QuantumApplication>(node->GetApplication(i));
+			if (!app) continue;
+			for (const auto& item : app->GetMemoryUsage())
+			{
+				std::cout << "Memory," << Simulator::Now().GetSeconds() 
+						  << ",app," << node->GetId() << "," << i << ","
+						  << item.first << "," << item.second << std::endl;
+			}
+		}
 	}
-	if (debug > 1)
-	{
-		LogComponentEnable("OpticalDevice", LOG_LEVEL_ALL);
-    }
-
-	/*Setup the Nodes*/
-	int num_nodes = nodes_per_switch * cluster_size * num_clusters;
-	int num_layer1 = cluster_size * num_clusters;
-	int num_layer2 = cluster_size * num_clusters;
-	int num_layer3 = cluster_size;
-	NodeContainer nodes;
-	for (int i = 0; i < num_nodes; i++)
+	for (auto c = ChannelList::Begin(); c != ChannelList::End(); c++)
 	{
-		Ptr<TimeNode> node = CreateObject<TimeNode>();
-		node->SetAttribute("Skew", DoubleValue(skew));
-		nodes.Add(node);
+		Ptr<OpticalChannel> chan = DynamicCast<OpticalChannel>(*c);
+		if (!chan) continue;
+		for (const auto& item : chan->GetMemoryUsage())
+		{
+			std::cout << "Memory," << Simulator::Now().GetSeconds() 
+					  << ",channel," << chan->GetId() << ",0,"
+					  << item.first << "," << item.second << std::endl;
+		}
 	}
-	NodeContainer layer1;
-	for (int i = 0; i < num_layer1; i++)
+	Simulator::Schedule(interval, &MemoryReport, interval);
+}
+
+class SimConfig
+{
+	public:
+		int num_qubits = 20;
+		float q_error = 0.5;
+		float c_error = 0.5;
+		int ave_send_time = 9000000;
+		int send_rng = 1000;
+		float skew = 0.0;
+		int reconfigure_time = 500;
+		int timeslot = 10000;
+		int packet_delay = 1000;
+		int max_tx_queue = 10000;
+		int num_channels = 10;
+		int profile = 0;
+		int static_routing = 1;
+		int ecmp = 0;
+		int awgr = 0;
+		int fast_forward = 0;
+		double fluid_load = 0;
+		double memory_interval = 0;
+		double telemetry_interval = 0;
+		double fork_at = 0;
+		std::string variants = "";
+		std::string telemetry_file = "telemetry.csv";
+		std::string control_scheduler = "Fifo";
+		std::string channel_selection = "Random";
+		std::string signalling = "Slotted";
+		int nodes_per_switch = 2;
+		int cluster_size = 2;
+		int num_clusters = 2;
+		Time app_start = Seconds(1);
+		Time app_stop = Seconds(10);
+		Time sim_stop = Seconds(11);
+};
+
+class SimStats
+{
+	public:
+		double setup_time = 0;
+		double run_time = 0;
+		uint64_t events = 0;
+		int num_nodes = 0;
+		int num_switches = 0;
+		int num_links = 0;
+		uint64_t delivered = 0;
+		bool warmup_parent = false;
+};
+
+/*
+Applies one variant, a comma separated list of Attribute=Value, to every
+QuantumApplication, OpticalDevice or OpticalChannel that has the attribute.
+*/
+bool
+ApplyVariant(const std::string& variant)
+{
+	std::stringstream values(variant);
+	std::string item;
+	while (std::getline(values, item, ','))
 	{
-		Ptr<TimeNode> node = CreateObject<TimeNode>();
-		node->SetAttribute("Skew", DoubleValue(skew));
-		layer1.Add(node);
+		size_t split = item.find('=');
+		if (split == std::string::npos)
+		{
+			std::cerr << "Invalid variant value " << item << std::endl;
+			return false;
+		}
+		std::string name = item.substr(0, split);
+		StringValue value(item.substr(split + 1));
+		TypeId::AttributeInformation info;
+		if (QuantumApplication::GetTypeId().LookupAttributeByName(name, &info))
+		{
+			Config::Set("/NodeList/*/ApplicationList/*/"
+						"$ns3::QuantumApplication/" + name, value);
+		}
+		else if (OpticalDevice::GetTypeId().LookupAttributeByName(name, &info))
+		{
+			Config::Set("/NodeList/*/DeviceList/*/$ns3::OpticalDevice/" + name,
+						value);
+		}
+		else if (OpticalChannel::GetTypeId().LookupAttributeByName(name, 
+																	&info))
+		{
+			Config::Set("/ChannelList/*/$ns3::OpticalChannel/" + name, value);
+		}
+		else
+		{
+			std::cerr << "Unknown variant attribute " << name << std::endl;
+			return false;
+		}
 	}
-	NodeContainer layer2;
-	for (int i = 0; i < num_layer2; i++)
+	return true;
+}
+
+// file.csv becomes file_variant<index>.csv
+std::string
+GetVariantFileName(const std::string& file_name, int index)
+{
+	std::string suffix = "_variant" + std::to_string(index);
+	size_t dot = file_name.rfind('.');
+	size_t slash = file_name.rfind('/');
+	if (dot == std::string::npos || 
+		(slash != std::string::npos && dot < slash))
 	{
-		Ptr<TimeNode> node = CreateObject<TimeNode>();
-		node->SetAttribute("Skew", DoubleValue(skew));
-		layer2.Add(node);
+		return file_name + suffix;
 	}
-	NodeContainer layer3;
-	for (int i = 0; i < num_layer3; i++)
+	return file_name.substr(0, dot) + suffix + file_name.substr(dot);
+}
+
+/*
+Runs the warm-up once and forks a child per variant from the warmed-up state.
+The fork keeps the whole simulation, pending events and RNG states included,
+which a file written by the module could not restore. Returns true in the
+children, which go on to run their variant, and false in the parent once all
+of them have finished. The warm-up samples of the telemetry stay in its file,
+each child writes its own samples to a file with a variant suffix.
+*/
+bool
+ForkVariants(const SimConfig& config, Ptr<OpticalTelemetry> telemetry)
+{
+	Time fork_at = config.fork_at > 0 ? Seconds(config.fork_at) : 
+										config.app_start;
+	Simulator::Stop(fork_at);
+	Simulator::Run();
+	std::stringstream variant_list(config.variants);
+	std::string variant;
+	int index = 0;
+	while (std::getline(variant_list, variant, ';'))
 	{
-		Ptr<TimeNode> node = CreateObject<TimeNode>();
-		node->SetAttribute("Skew", DoubleValue(skew));
-		layer3.Add(node);
+		std::cout.flush();
+		if (telemetry)
+		{
+			telemetry->Flush();
+		}
+		pid_t pid = fork();
+		if (pid < 0)
+		{
+			std::cerr << "Could not fork variant " << variant << std::endl;
+			return false;
+		}
+		if (pid == 0)
+		{
+			drop_count = 0;
+			collision_count = 0;
+			std::cout << "Variant," << index << "," << variant << std::endl;
+			if (!ApplyVariant(variant))
+			{
+				_exit(1);
+			}
+			if (telemetry)
+			{
+				telemetry->Reopen(
+					GetVariantFileName(config.telemetry_file, index));
+			}
+			return true;
+		}
+		int status = 0;
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			std::cerr << "Variant " << variant << " failed." << std::endl;
+		}
+		index++;
 	}
-	NodeContainer all;
-	all.Add(nodes);
-	all.Add(layer1);
-	all.Add(layer2);
-	all.Add(layer3);
+	return false;
+}
+
+SimStats
+RunSimulation(const SimConfig& config)
+{
+	SimStats stats;
+	auto setup_start = std::chrono::steady_clock::now();
+	int nodes_per_switch = config.nodes_per_switch;
+	int cluster_size = config.cluster_size;
+	int num_clusters = config.num_clusters;
+	float skew = config.skew;
 
 	/*Setup the optical network*/
-	OpticalHelper helper;
+	FatTreeHelper fat_tree;
+	fat_tree.SetClustered(nodes_per_switch, cluster_size, num_clusters);
+	fat_tree.SetSkew(skew);
+	OpticalHelper& helper = fat_tree.GetOpticalHelper();
 	helper.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1024p"));
 	helper.SetDeviceAttribute("FailureRate", DoubleValue(0));
 	helper.SetDeviceAttribute("ControlDataRate",
@@ -189,115 +317,45 @@ main(int argc, char* argv[])
 		DataRateValue(DataRate("40Gbps")));
 	helper.SetDeviceAttribute("ControlFrameGap", TimeValue(NanoSeconds(5)));
 	helper.SetDeviceAttribute("DataFrameGap", TimeValue(NanoSeconds(5)));
-	helper.SetDeviceAttribute("PacketDelay", TimeValue(NanoSeconds(packet_delay)));
-	helper.SetDeviceAttribute("SwitchPropagationDelay",
-		TimeValue(NanoSeconds(2)));
-	helper.SetDeviceAttribute("TotalPropagationDelay",
-		TimeValue(NanoSeconds(36)));
+	Time packet_delay = config.packet_delay > 0 ? 
+		NanoSeconds(config.packet_delay) : fat_tree.GetPacketDelay();
+	Time timeslot = config.timeslot > 0 ? 
+		NanoSeconds(config.timeslot) : fat_tree.GetTimeslotDuration();
+	helper.SetDeviceAttribute("PacketDelay", TimeValue(packet_delay));
 	helper.SetDeviceAttribute("ReconfigureTime", 
-		TimeValue(NanoSeconds(reconfigure_time)));
-	helper.SetDeviceAttribute("TimeslotDuration", 
-		TimeValue(NanoSeconds(timeslot)));
+		TimeValue(NanoSeconds(config.reconfigure_time)));
+	helper.SetDeviceAttribute("TimeslotDuration", TimeValue(timeslot));
 	helper.SetDeviceAttribute("PacketProcessing", TimeValue(NanoSeconds(350)));
 	helper.SetDeviceAttribute("OpticalProcessing", TimeValue(NanoSeconds(350)));
-	helper.SetChannelAttribute("Delay", TimeValue(NanoSeconds(5)));
-	helper.SetChannelAttribute("NumChannels", UintegerValue(num_channels));
+	helper.SetDeviceAttribute("ControlScheduler", 
+		StringValue(config.control_scheduler));
+	helper.SetDeviceAttribute("ChannelSelection", 
+		StringValue(config.channel_selection));
+	helper.SetDeviceAttribute("Signalling", StringValue(config.signalling));
+	helper.SetDeviceAttribute("FastForward", 
+		BooleanValue(config.fast_forward > 0));
+	helper.SetChannelAttribute("NumChannels",
+		UintegerValue(config.num_channels));
+	fat_tree.SetAwgr(config.awgr > 0);
+	fat_tree.Install();
+	NodeContainer nodes = fat_tree.GetEndpoints();
+	Ipv4InterfaceContainer node_addr = fat_tree.GetEndpointInterfaces();
+	int num_nodes = nodes.GetN();
 
-	/*Setup nodes/layer1*/
-	int delay;
-	int distance;
-	int index1;
-	int index2;
-	int index3;
-	NetDeviceContainer *node_devs = new NetDeviceContainer[num_nodes];
-	//Loop through layer1 switches
-	for (int l1 = 0; l1 < num_layer1; l1++)
+	/*Setup Routing*/
+	if (config.static_routing > 0)
 	{
-		//Loop through nodes attached to switch
-		distance = 3;
-		for (int n = 0; n < nodes_per_switch; n++)
-		{
-			if (n % 2 == 1) distance += 3;
-			delay = distance * 5;
-			helper.SetChannelAttribute("Delay", TimeValue(NanoSeconds(delay)));
-			index1 = (l1 * nodes_per_switch) + n;
-			node_devs[index1] = helper.Install(nodes.Get(index1), 
-											   layer1.Get(l1)); 
-		}
+		fat_tree.PopulateRoutingTables();
 	}
-
-	/*Setup layer1/layer2*/
-	int total_switch_devs = (num_clusters * (cluster_size * cluster_size)) + 
-							(num_clusters * cluster_size);
-	index3 = 0;
-	NetDeviceContainer *switch_devs = new NetDeviceContainer[total_switch_devs];
-	distance = 3 * (nodes_per_switch - 1);
-	//Loop through the blocks of switches
-	for (int c = 0; c < num_clusters; c++)
+	else
 	{
-		for (int l1 = 0; l1 < cluster_size; l1++)
-		{
-			for (int l2 = 0; l2 < cluster_size; l2++)
-			{
-				delay = (3 + (distance * std::abs(l1 - l2))) * 5;
-				helper.SetChannelAttribute("Delay", 
-										   TimeValue(NanoSeconds(delay)));
-				index1 = (c * cluster_size) + l1;
-				index2 = (c * cluster_size) + l2;
-				switch_devs[index3++] = helper.Install(layer1.Get(index1), 
-											  		   layer2.Get(index2));
-			}
-		}
-	}
-
-	/*Setup layer2/layer3*/
-	for (int c = 0; c < num_clusters; c++)
-	{
-		distance = 3;
-		for (int i = 0; i < cluster_size; i++)
-		{
-			if (i % 2 == 1) distance += 5;
-			delay = distance * 5;
-			helper.SetChannelAttribute("Delay", TimeValue(NanoSeconds(delay)));
-			index1 = (c * cluster_size) + i;
-			switch_devs[index3++] = helper.Install(layer2.Get(index1), 
-												   layer3.Get(i));
-		}
+		Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 	}
-	
-	/*Add Internet Stack*/
-	InternetStackHelper stack;
-	stack.Install(all);
-
-	/*Set addresses*/
-	Ipv4AddressHelper address;
-	index1 = 0;
-	for (int i = 0; i < total_switch_devs; i++)
+	if (config.ecmp > 0)
 	{
-		std::stringstream ss;
-		ss << "10.1." << index1++ << ".0";
-		std::string ip = ss.str();
-		const char *ip_c = ip.c_str();
-		address.SetBase(Ipv4Address(ip_c), Ipv4Mask("255.255.255.0"));
-		address.Assign(switch_devs[i]);
+		fat_tree.EnableEcmp();
 	}
 
-	Ipv4InterfaceContainer *node_addr = new Ipv4InterfaceContainer[num_nodes];
-	for (int i = 0; i < num_nodes; i++)
-	{
-		std::stringstream ss;
-		ss << "10.1." << index1++ << ".0";
-		std::string ip = ss.str();
-		const char *ip_c = ip.c_str();
-		address.SetBase(Ipv4Address(ip_c), Ipv4Mask("255.255.255.0"));
-		node_addr[i] = address.Assign(node_devs[i]);
-	}
-
-	/*Setup Routing and initialization*/
-	helper.SetEndpoints(nodes);
-	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
-	helper.Initialize(all);
-
 	/*Register trace sinks*/
 	Config::Connect("/NodeList/*/DeviceList/*/$ns3::OpticalDevice/DropTrace", 
 					MakeCallback(&DropSink));
@@ -309,16 +367,17 @@ main(int argc, char* argv[])
 	/*Setup Quantum Application*/
 	ApplicationContainer apps;
 	QuantumHelper q_helper;
-	q_helper.SetAttribute("NumQubits", UintegerValue(num_qubits));
-	q_helper.SetAttribute("QuantumFailureRate", DoubleValue(q_error));
-	q_helper.SetAttribute("ClassicalFailureRate", DoubleValue(c_error));
+	q_helper.SetAttribute("NumQubits", UintegerValue(config.num_qubits));
+	q_helper.SetAttribute("QuantumFailureRate", DoubleValue(config.q_error));
+	q_helper.SetAttribute("ClassicalFailureRate", DoubleValue(config.c_error));
 	q_helper.SetAttribute("EntanglementTime", UintegerValue(50));
-	q_helper.SetAttribute("AverageSendTime", UintegerValue(ave_send_time));
-	q_helper.SetAttribute("SendTimeRange", UintegerValue(send_rng));
-	q_helper.SetAttribute("MaxTxQueue", UintegerValue(max_tx_queue));
+	q_helper.SetAttribute("AverageSendTime",
+		UintegerValue(config.ave_send_time));
+	q_helper.SetAttribute("SendTimeRange", UintegerValue(config.send_rng));
+	q_helper.SetAttribute("MaxTxQueue", UintegerValue(config.max_tx_queue));
 	for (int i = 0; i < num_nodes; i++)
 	{
-		Address addr = InetSocketAddress(node_addr[i].GetAddress(0), i + 1);
+		Address addr = InetSocketAddress(node_addr.GetAddress(i), i + 1);
 		Ptr<Node> node = nodes.Get(i);
 		q_helper.SetAttribute("ID", UintegerValue(i));
 		q_helper.SetAttribute("Local", AddressValue(addr));
@@ -328,20 +387,272 @@ main(int argc, char* argv[])
 		for (int j = 0; j < num_nodes; j++)
 		{
 			if (i == j) continue;
-			addr = InetSocketAddress(node_addr[j].GetAddress(0), j + 1);
+			addr = InetSocketAddress(node_addr.GetAddress(j), j + 1);
 			app->AddPeer(addr);
 		}
 	}
-	apps.Start(Seconds(1));
-	apps.Stop(Seconds(10));
+	apps.Start(config.app_start);
+	apps.Stop(config.app_stop);
+	if (config.fluid_load > 0)
+	{
+		FluidTrafficHelper fluid;
+		fluid.SetLoad(config.fluid_load);
+		NodeContainer switches(fat_tree.GetLayer1(), fat_tree.GetLayer2(),
+							   fat_tree.GetLayer3());
+		fluid.Install(switches, config.app_start, config.app_stop);
+	}
+
+	stats.num_nodes = num_nodes;
+	stats.num_switches = fat_tree.GetNSwitches();
+	stats.num_links = fat_tree.GetNLinks();
+	auto run_start = std::chrono::steady_clock::now();
+	stats.setup_time = 
+		std::chrono::duration<double>(run_start - setup_start).count();
 
-	Simulator::Stop(Seconds(11));
-    Simulator::Run();
-    Simulator::Destroy();
-	delete[] node_devs;
-	delete[] switch_devs;
-	delete[] node_addr;
+	Simulator::Stop(config.sim_stop);
+	if (config.profile > 0)
+	{
+		OpticalProfiler::Enable();
+	}
+	if (config.memory_interval > 0)
+	{
+		Time interval = Seconds(config.memory_interval);
+		Simulator::Schedule(config.app_start, &MemoryReport, interval);
+	}
+	Ptr<OpticalTelemetry> telemetry;
+	if (config.telemetry_interval > 0)
+	{
+		telemetry = CreateObject<OpticalTelemetry>();
+		telemetry->SetAttribute("Interval", 
+			TimeValue(Seconds(config.telemetry_interval)));
+		telemetry->SetAttribute("FileName", 
+			StringValue(config.telemetry_file));
+		telemetry->Start(config.app_start);
+	}
+	if (!config.variants.empty())
+	{
+		stats.warmup_parent = !ForkVariants(config, telemetry);
+	}
+	if (!stats.warmup_parent)
+	{
+		Simulator::Run();
+	}
+	stats.run_time = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - run_start).count();
+	stats.events = Simulator::GetEventCount();
+	for (uint32_t i = 0; i < apps.GetN(); i++)
+	{
+		Ptr<QuantumApplication> app = 
+			DynamicCast<QuantumApplication>(apps.Get(i));
+		stats.delivered += app->GetDeliveredCount();
+	}
+	if (config.profile > 0)
+	{
+		OpticalProfiler::Print(std::cout);
+		OpticalProfiler::Disable();
+	}
+	if (telemetry)
+	{
+		telemetry->Stop();
+	}
+	Simulator::Destroy();
+	return stats;
+}
+
+long
+GetPeakRss()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/*
+Runs every size of the sweep in its own child process so the peak RSS
+reported for a size is not inherited from a larger size run before it.
+*/
+int
+RunScalingBenchmark(SimConfig config, std::string sizes, double horizon,
+					std::string out_file)
+{
+	std::ofstream out(out_file);
+	if (!out.is_open())
+	{
+		std::cerr << "Could not open " << out_file << std::endl;
+		return 1;
+	}
+	out << "nodes_per_switch,cluster_size,num_clusters,endpoints,switches,"
+		<< "links,setup_s,wall_s,events,events_per_s,peak_rss_kb,"
+		<< "sim_s_per_wall_s" << std::endl;
+	out.close();
+
+	config.app_stop = config.app_start + Seconds(horizon);
+	config.sim_stop = config.app_stop;
+	std::stringstream size_list(sizes);
+	std::string size;
+	while (std::getline(size_list, size, ','))
+	{
+		int nps = 0;
+		int cs = 0;
+		int nc = 0;
+		char sep1 = 0;
+		char sep2 = 0;
+		std::stringstream ss(size);
+		ss >> nps >> sep1 >> cs >> sep2 >> nc;
+		if (ss.fail() || sep1 != 'x' || sep2 != 'x' || 
+			nps <= 0 || cs <= 0 || nc <= 0)
+		{
+			std::cerr << "Invalid size " << size << ", expected NxCxK" 
+					  << std::endl;
+			return 1;
+		}
+		std::cout.flush();
+		pid_t pid = fork();
+		if (pid < 0)
+		{
+			std::cerr << "Could not fork benchmark run." << std::endl;
+			return 1;
+		}
+		if (pid == 0)
+		{
+			config.nodes_per_switch = nps;
+			config.cluster_size = cs;
+			config.num_clusters = nc;
+			SimStats stats = RunSimulation(config);
+			double sim_seconds = config.sim_stop.GetSeconds();
+			std::ofstream row(out_file, std::ios::app);
+			row << nps << "," << cs << "," << nc << "," << stats.num_nodes 
+				<< "," << stats.num_switches << "," << stats.num_links << "," 
+				<< stats.setup_time << "," << stats.run_time << "," 
+				<< stats.events << ","
+				<< (stats.run_time > 0 ? stats.events / stats.run_time : 0)
+				<< "," << GetPeakRss() << ","
+				<< (stats.run_time > 0 ? sim_seconds / stats.run_time : 0)
+				<< std::endl;
+			row.close();
+			std::cout.flush();
+			_exit(0);
+		}
+		int status = 0;
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			std::cerr << "Benchmark run " << size << " failed." << std::endl;
+			return 1;
+		}
+		drop_count = 0;
+		collision_count = 0;
+	}
+	return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+	// Setup command line arguments
+	SimConfig config;
+	int debug = 0;
+	int benchmark = 0;
+	std::string bench_sizes = "2x2x2,3x3x3,4x4x4";
+	double bench_horizon = 0.01;
+	std::string bench_out = "scaling.csv";
+	CommandLine cmd(__FILE__);
+	cmd.AddValue("qubits", "The number of qubits in QNIC.", config.num_qubits);
+	cmd.AddValue("qerror", "The error rate for quantum traffic.",
+				 config.q_error);
+	cmd.AddValue("cerror", "The error rate for classical traffic.",
+				 config.c_error);
+	cmd.AddValue("send-time", "The average time between messages.", 
+				 config.ave_send_time);
+	cmd.AddValue("send-range", "The range in time between send messages.",
+				 config.send_rng);
+	cmd.AddValue("skew", "The amount of skew clocks will have.", config.skew);
+	cmd.AddValue("reconfigure", "The reconfigure time of switches.", 
+				 config.reconfigure_time);
+	cmd.AddValue("timeslot", "The duration of the timeslot (ns), 0 derives it "
+				 "from the topology.",
+				 config.timeslot);
+	cmd.AddValue("packet-delay", "Time between control and data (ns), 0 "
+				 "derives it from the topology.",
+				 config.packet_delay);
+	cmd.AddValue("max-tx-queue", "Maximum size of tx_queue before app closes.", 
+				 config.max_tx_queue);
+	cmd.AddValue("num-channels", "The number of optical channels used",
+				 config.num_channels);
+	cmd.AddValue("nodes-per-switch", "The number of nodes attached to a switch",
+				 config.nodes_per_switch);
+	cmd.AddValue("cluster-size", "Each cluster will have 2 * cluster-size "
+				 "switches and cluster-size * nodes-per-switch of nodes.",
+				 config.cluster_size);
+	cmd.AddValue("num-clusters", "The number of clusters.",
+				 config.num_clusters);
+	cmd.AddValue("debug", "Debug level 0-none, 1-app, 2-app+optical", debug);
+	cmd.AddValue("static-routing", "Routing 0-global, 1-static fat-tree "
+				 "up/down routes", config.static_routing);
+	cmd.AddValue("ecmp", "Move reservations to the least occupied uplink "
+				 "0-off, 1-on", config.ecmp);
+	cmd.AddValue("awgr", "Core switches 0-reconfiguring, 1-passive AWGR",
+				 config.awgr);
+	cmd.AddValue("fast-forward", "Deliver data bursts with one event "
+				 "0-off, 1-on", config.fast_forward);
+	cmd.AddValue("fluid-load", "Fraction [0-1] of every switch timeslot held "
+				 "by fluid background traffic.", config.fluid_load);
+	cmd.AddValue("control-scheduler", "Control queue order Fifo or Edf.",
+				 config.control_scheduler);
+	cmd.AddValue("channel-selection", "Burst channel Random, FirstFit or "
+				 "LeastLoaded.", config.channel_selection);
+	cmd.AddValue("signalling", "Reservation timing Slotted, Jet or Jit.",
+				 config.signalling);
+	cmd.AddValue("profile", "Profile module handlers 0-off, 1-on",
+				 config.profile);
+	cmd.AddValue("memory-interval", "Seconds between per-container memory "
+				 "reports, 0 disables them.", config.memory_interval);
+	cmd.AddValue("telemetry-interval", "Seconds between telemetry samples, "
+				 "0 disables the sampler.", config.telemetry_interval);
+	cmd.AddValue("telemetry-file", "The file telemetry samples are written to, "
+				 "forked variants add _variant<index> to the name.",
+				 config.telemetry_file);
+	cmd.AddValue("variants", "Semicolon separated variants of comma separated "
+				 "Attribute=Value pairs, each run from one warmed-up state.",
+				 config.variants);
+	cmd.AddValue("fork-at", "Simulated seconds of shared warm-up before the "
+				 "variants fork, 0 forks when the applications start.",
+				 config.fork_at);
+	cmd.AddValue("benchmark", "Sweep fat-tree sizes 0-off, 1-on", benchmark);
+	cmd.AddValue("bench-sizes", "Comma separated sizes swept by the benchmark "
+				 "as nodes-per-switch x cluster-size x num-clusters.",
+				 bench_sizes);
+	cmd.AddValue("bench-horizon", "Simulated seconds each size runs after the "
+				 "applications start.", bench_horizon);
+	cmd.AddValue("bench-out", "The csv file the benchmark table is written to.",
+				 bench_out);
+    cmd.Parse(argc, argv);
+
+	// Setup logging
+	if (debug > 0)
+	{
+		LogComponentEnable("QuantumApplication", LOG_LEVEL_ALL);
+	}
+	if (debug > 1)
+	{
+		LogComponentEnable("OpticalDevice", LOG_LEVEL_ALL);
+    }
+
+	if (benchmark > 0)
+	{
+		return RunScalingBenchmark(config, bench_sizes, bench_horizon,
+								   bench_out);
+	}
+
+	SimStats stats = RunSimulation(config);
+	if (stats.warmup_parent)
+	{
+		return 0;
+	}
 	std::cout << "CollisionCount," << collision_count << std::endl;
 	std::cout << "DropCount," << drop_count << std::endl;
+	const memory::PoolCounters& pool = memory::GetPoolCounters();
+	std::cout << "PoolNodes," << pool.requests << "," << pool.heap << ","
+			  << stats.delivered << std::endl;
     return 0;
 }
@@ -0,0 +1,520 @@
+#include "ns3/fat-tree-helper.h"
+#include "ns3/optical-address-helper.h"
+#include "ns3/time-node.h"
+
+#include "ns3/double.h"
+#include "ns3/ipv4-static-routing.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+	NS_LOG_COMPONENT_DEFINE("FatTreeHelper");
+
+	FatTreeHelper::FatTreeHelper()
+		: m_nodes_per_switch(2),
+		  m_cluster_size(2),
+		  m_num_clusters(2),
+		  m_cores_per_agg(1),
+		  m_skew(0.0),
+		  m_address_base("10.1.0.0"),
+		  m_prefix_length(30),
+		  m_link_delay_unit(NanoSeconds(5)),
+		  m_switch_propagation_delay(NanoSeconds(2)),
+		  m_packet_processing(NanoSeconds(350)),
+		  m_control_tx_time(NanoSeconds(14)),
+		  m_data_tx_time(NanoSeconds(30)),
+		  m_packet_delay_padding(NanoSeconds(100)),
+		  m_timeslot_padding(NanoSeconds(100)),
+		  m_derive_timing(false),
+		  m_awgr(false),
+		  m_endpoint_block(1),
+		  m_cluster_block(1)
+	{
+
+	}
+
+	FatTreeHelper::~FatTreeHelper()
+	{
+
+	}
+
+	OpticalHelper&
+	FatTreeHelper::GetOpticalHelper()
+	{
+		return m_optical;
+	}
+
+	void
+	FatTreeHelper::SetClustered(uint32_t nodes_per_switch,
+								uint32_t cluster_size,
+								uint32_t num_clusters)
+	{
+		NS_ASSERT_MSG(nodes_per_switch > 0 && cluster_size > 0 &&
+					  num_clusters > 0, "Fat-tree dimensions must be positive.");
+		m_nodes_per_switch = nodes_per_switch;
+		m_cluster_size = cluster_size;
+		m_num_clusters = num_clusters;
+		m_cores_per_agg = 1;
+	}
+
+	void
+	FatTreeHelper::SetKAry(uint32_t k)
+	{
+		NS_ASSERT_MSG(k >= 2 && k % 2 == 0, "k must be even.");
+		m_nodes_per_switch = k / 2;
+		m_cluster_size = k / 2;
+		m_num_clusters = k;
+		m_cores_per_agg = k / 2;
+	}
+
+	void
+	FatTreeHelper::SetSkew(double skew)
+	{
+		m_skew = skew;
+	}
+
+	void
+	FatTreeHelper::SetAddressBase(Ipv4Address base, uint8_t prefix_length)
+	{
+		m_address_base = base;
+		m_prefix_length = prefix_length;
+	}
+
+	void
+	FatTreeHelper::SetLinkDelayUnit(Time t)
+	{
+		m_link_delay_unit = t;
+	}
+
+	void
+	FatTreeHelper::SetSwitchPropagationDelay(Time t)
+	{
+		m_switch_propagation_delay = t;
+	}
+
+	void
+	FatTreeHelper::SetPacketProcessing(Time t)
+	{
+		m_packet_processing = t;
+	}
+
+	void
+	FatTreeHelper::SetControlTxTime(Time t)
+	{
+		m_control_tx_time = t;
+	}
+
+	void
+	FatTreeHelper::SetDataTxTime(Time t)
+	{
+		m_data_tx_time = t;
+	}
+
+	void
+	FatTreeHelper::SetPadding(Time packet_delay_padding, Time timeslot_padding)
+	{
+		m_packet_delay_padding = packet_delay_padding;
+		m_timeslot_padding = timeslot_padding;
+	}
+
+	void
+	FatTreeHelper::SetDeriveTiming(bool derive)
+	{
+		m_derive_timing = derive;
+	}
+
+	void
+	FatTreeHelper::SetAwgr(bool awgr)
+	{
+		m_awgr = awgr;
+	}
+
+	Time
+	FatTreeHelper::GetEndpointLinkDelay(uint32_t n) const
+	{
+		// Every second endpoint sits one rack unit further away
+		return m_link_delay_unit * (3 + 3 * ((n + 1) / 2));
+	}
+
+	Time
+	FatTreeHelper::GetAggregationLinkDelay(uint32_t l1, uint32_t l2) const
+	{
+		uint32_t offset = l1 > l2 ? l1 - l2 : l2 - l1;
+		return m_link_delay_unit *
+			(3 + 3 * (m_nodes_per_switch - 1) * offset);
+	}
+
+	Time
+	FatTreeHelper::GetCoreLinkDelay(uint32_t i) const
+	{
+		return m_link_delay_unit * (3 + 5 * ((i + 1) / 2));
+	}
+
+	Time
+	FatTreeHelper::GetMaxPropagationDelay() const
+	{
+		// Up and down through all three layers, crossing five switches
+		Time up = GetEndpointLinkDelay(m_nodes_per_switch - 1) +
+				  GetAggregationLinkDelay(0, m_cluster_size - 1) +
+				  GetCoreLinkDelay(m_cluster_size * m_cores_per_agg - 1);
+		return up * 2 + m_switch_propagation_delay * 5;
+	}
+
+	Time
+	FatTreeHelper::GetPacketDelay() const
+	{
+		return (m_packet_processing + m_control_tx_time) * 6 +
+			GetMaxPropagationDelay() + m_packet_delay_padding;
+	}
+
+	Time
+	FatTreeHelper::GetTimeslotDuration() const
+	{
+		return GetPacketDelay() + GetMaxPropagationDelay() + m_data_tx_time +
+			m_timeslot_padding;
+	}
+
+	NodeContainer
+	FatTreeHelper::CreateNodes(uint32_t count) const
+	{
+		NodeContainer c;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Ptr<TimeNode> node = CreateObject<TimeNode>();
+			node->SetAttribute("Skew", DoubleValue(m_skew));
+			c.Add(node);
+		}
+		return c;
+	}
+
+	void
+	FatTreeHelper::Install()
+	{
+		NS_LOG_FUNCTION(this);
+		uint32_t num_layer1 = m_cluster_size * m_num_clusters;
+		uint32_t num_layer3 = m_cluster_size * m_cores_per_agg;
+		m_endpoints = CreateNodes(m_nodes_per_switch * num_layer1);
+		m_layer1 = CreateNodes(num_layer1);
+		m_layer2 = CreateNodes(num_layer1);
+		m_layer3 = CreateNodes(num_layer3);
+
+		m_optical.SetDeviceAttribute("TotalPropagationDelay",
+									 TimeValue(GetMaxPropagationDelay()));
+		m_optical.SetDeviceAttribute("SwitchPropagationDelay",
+									 TimeValue(m_switch_propagation_delay));
+		if (m_derive_timing)
+		{
+			m_optical.SetDeviceAttribute("PacketDelay",
+										 TimeValue(GetPacketDelay()));
+			m_optical.SetDeviceAttribute("TimeslotDuration",
+										 TimeValue(GetTimeslotDuration()));
+		}
+
+		/*Endpoints to layer1*/
+		m_endpoint_links.clear();
+		m_endpoint_links.reserve(m_endpoints.GetN());
+		for (uint32_t l1 = 0; l1 < num_layer1; l1++)
+		{
+			for (uint32_t n = 0; n < m_nodes_per_switch; n++)
+			{
+				m_optical.SetChannelAttribute("Delay",
+					TimeValue(GetEndpointLinkDelay(n)));
+				uint32_t index = (l1 * m_nodes_per_switch) + n;
+				m_endpoint_links.push_back(
+					m_optical.Install(m_endpoints.Get(index), m_layer1.Get(l1)));
+			}
+		}
+
+		/*Layer1 to layer2 inside each cluster*/
+		m_switch_links.clear();
+		m_switch_links.reserve(m_num_clusters * m_cluster_size *
+							   (m_cluster_size + m_cores_per_agg));
+		for (uint32_t c = 0; c < m_num_clusters; c++)
+		{
+			for (uint32_t l1 = 0; l1 < m_cluster_size; l1++)
+			{
+				for (uint32_t l2 = 0; l2 < m_cluster_size; l2++)
+				{
+					m_optical.SetChannelAttribute("Delay",
+						TimeValue(GetAggregationLinkDelay(l1, l2)));
+					uint32_t index1 = (c * m_cluster_size) + l1;
+					uint32_t index2 = (c * m_cluster_size) + l2;
+					m_switch_links.push_back(
+						m_optical.Install(m_layer1.Get(index1),
+										  m_layer2.Get(index2)));
+				}
+			}
+		}
+
+		/*Layer2 to layer3*/
+		for (uint32_t c = 0; c < m_num_clusters; c++)
+		{
+			for (uint32_t l2 = 0; l2 < m_cluster_size; l2++)
+			{
+				for (uint32_t j = 0; j < m_cores_per_agg; j++)
+				{
+					uint32_t core = (l2 * m_cores_per_agg) + j;
+					m_optical.SetChannelAttribute("Delay",
+						TimeValue(GetCoreLinkDelay(core)));
+					uint32_t index = (c * m_cluster_size) + l2;
+					m_switch_links.push_back(
+						m_optical.Install(m_layer2.Get(index),
+										  m_layer3.Get(core)));
+				}
+			}
+		}
+
+		NodeContainer all = GetAll();
+		m_stack.Install(all);
+		AssignAddresses();
+		m_optical.SetEndpoints(m_endpoints);
+		// Only the core is a grating, without wavelength conversion a
+		// second one on the path rarely leaves a channel that fits both
+		if (m_awgr)
+		{
+			m_optical.InstallAwgr(m_layer3);
+		}
+		m_optical.Initialize(all);
+	}
+
+	static uint32_t
+	NextPowerOfTwo(uint32_t value)
+	{
+		uint32_t power = 1;
+		while (power < value)
+		{
+			power <<= 1;
+		}
+		return power;
+	}
+
+	void
+	FatTreeHelper::AssignAddresses()
+	{
+		// One subnet per link counted up from the base, switch links first
+		OpticalAddressHelper address(m_address_base, m_prefix_length);
+		m_switch_interfaces.clear();
+		m_switch_interfaces.reserve(m_switch_links.size());
+		for (const auto& link : m_switch_links)
+		{
+			m_switch_interfaces.push_back(address.Assign(link));
+		}
+
+		// Endpoints of a layer1 switch, and layer1 switches of a cluster,
+		// share aligned blocks so a single route covers each of them
+		m_endpoint_block = NextPowerOfTwo(m_nodes_per_switch);
+		m_cluster_block = NextPowerOfTwo(m_cluster_size);
+		address.AlignTo(NextPowerOfTwo(m_num_clusters) * m_cluster_block *
+						m_endpoint_block);
+		m_endpoint_base = address.GetNextNetwork();
+		m_endpoint_interfaces = Ipv4InterfaceContainer();
+		m_endpoint_link_interfaces.clear();
+		m_endpoint_link_interfaces.reserve(m_endpoint_links.size());
+		for (uint32_t k = 0; k < m_endpoint_links.size(); k++)
+		{
+			if (k % m_nodes_per_switch == 0)
+			{
+				address.AlignTo(m_endpoint_block);
+				if ((k / m_nodes_per_switch) % m_cluster_size == 0)
+				{
+					address.AlignTo(m_cluster_block * m_endpoint_block);
+				}
+			}
+			Ipv4InterfaceContainer interfaces = 
+				address.Assign(m_endpoint_links[k]);
+			m_endpoint_link_interfaces.push_back(interfaces);
+			m_endpoint_interfaces.Add(interfaces.Get(0));
+		}
+	}
+
+	Ipv4Address
+	FatTreeHelper::GetBlockNetwork(uint32_t index, uint32_t subnets) const
+	{
+		uint32_t subnet_size = 1u << (32 - m_prefix_length);
+		return Ipv4Address(m_endpoint_base.Get() + 
+						   index * subnets * subnet_size);
+	}
+
+	Ipv4Mask
+	FatTreeHelper::GetBlockMask(uint32_t subnets) const
+	{
+		uint32_t host_bits = 32 - m_prefix_length;
+		while (subnets > 1)
+		{
+			host_bits++;
+			subnets >>= 1;
+		}
+		return Ipv4Mask(host_bits >= 32 ? 0 : 0xffffffff << host_bits);
+	}
+
+	void
+	FatTreeHelper::AddRoute(uint32_t link, uint32_t side, uint32_t index,
+							uint32_t subnets)
+	{
+		const Ipv4InterfaceContainer& interfaces = m_switch_interfaces[link];
+		Ipv4StaticRoutingHelper static_routing;
+		Ptr<Ipv4StaticRouting> routing = 
+			static_routing.GetStaticRouting(interfaces.Get(side).first);
+		routing->AddNetworkRouteTo(GetBlockNetwork(index, subnets),
+								   GetBlockMask(subnets),
+								   interfaces.GetAddress(1 - side),
+								   interfaces.Get(side).second);
+	}
+
+	void
+	FatTreeHelper::AddDefaultRoute(const Ipv4InterfaceContainer& link,
+								   uint32_t side)
+	{
+		Ipv4StaticRoutingHelper static_routing;
+		Ptr<Ipv4StaticRouting> routing = 
+			static_routing.GetStaticRouting(link.Get(side).first);
+		routing->SetDefaultRoute(link.GetAddress(1 - side), 
+								 link.Get(side).second);
+	}
+
+	void
+	FatTreeHelper::PopulateRoutingTables()
+	{
+		NS_LOG_FUNCTION(this);
+		uint32_t cs = m_cluster_size;
+		uint32_t nc = m_num_clusters;
+		uint32_t cpa = m_cores_per_agg;
+		uint32_t l1_subnets = m_endpoint_block;
+		uint32_t cluster_subnets = m_cluster_block * m_endpoint_block;
+		uint32_t core_links = nc * cs * cs;
+
+		/*Endpoints only have their layer1 switch*/
+		for (const auto& link : m_endpoint_link_interfaces)
+		{
+			AddDefaultRoute(link, 0);
+		}
+
+		for (uint32_t c = 0; c < nc; c++)
+		{
+			for (uint32_t l = 0; l < cs; l++)
+			{
+				/*Layer1 up, spread by destination over the layer2 switches*/
+				for (uint32_t dst = 0; dst < cs; dst++)
+				{
+					if (dst == l) continue;
+					uint32_t l2 = (l + dst) % cs;
+					AddRoute(((c * cs) + l) * cs + l2, 0,
+							 (c * m_cluster_block) + dst, l1_subnets);
+				}
+				for (uint32_t dst = 0; dst < nc; dst++)
+				{
+					if (dst == c) continue;
+					uint32_t l2 = (l + dst) % cs;
+					AddRoute(((c * cs) + l) * cs + l2, 0, dst, 
+							 cluster_subnets);
+				}
+
+				/*Layer2 down to every layer1 switch of the cluster*/
+				for (uint32_t l1 = 0; l1 < cs; l1++)
+				{
+					AddRoute(((c * cs) + l1) * cs + l, 1,
+							 (c * m_cluster_block) + l1, l1_subnets);
+				}
+
+				/*Layer2 up, spread by destination cluster over its cores*/
+				uint32_t agg = (c * cs) + l;
+				if (cpa == 1)
+				{
+					AddDefaultRoute(m_switch_interfaces[core_links + agg], 0);
+				}
+				else
+				{
+					for (uint32_t dst = 0; dst < nc; dst++)
+					{
+						if (dst == c) continue;
+						AddRoute(core_links + (agg * cpa) + (dst % cpa), 0,
+								 dst, cluster_subnets);
+					}
+				}
+
+				/*Cores down to the layer2 switch of every cluster*/
+				for (uint32_t j = 0; j < cpa; j++)
+				{
+					AddRoute(core_links + (agg * cpa) + j, 1, c, 
+							 cluster_subnets);
+				}
+			}
+		}
+	}
+
+	void
+	FatTreeHelper::EnableEcmp()
+	{
+		NS_LOG_FUNCTION(this);
+		// Every uplink reaches every destination outside the switch, the
+		// lower layer device is the first of each link
+		for (const auto& link : m_switch_links)
+		{
+			link.Get(0)->SetAttribute("EcmpGroup", UintegerValue(1));
+		}
+	}
+
+	NodeContainer
+	FatTreeHelper::GetEndpoints() const
+	{
+		return m_endpoints;
+	}
+
+	NodeContainer
+	FatTreeHelper::GetLayer1() const
+	{
+		return m_layer1;
+	}
+
+	NodeContainer
+	FatTreeHelper::GetLayer2() const
+	{
+		return m_layer2;
+	}
+
+	NodeContainer
+	FatTreeHelper::GetLayer3() const
+	{
+		return m_layer3;
+	}
+
+	NodeContainer
+	FatTreeHelper::GetAll() const
+	{
+		NodeContainer all;
+		all.Add(m_endpoints);
+		all.Add(m_layer1);
+		all.Add(m_layer2);
+		all.Add(m_layer3);
+		return all;
+	}
+
+	Ipv4InterfaceContainer
+	FatTreeHelper::GetEndpointInterfaces() const
+	{
+		return m_endpoint_interfaces;
+	}
+
+	uint32_t
+	FatTreeHelper::GetNEndpoints() const
+	{
+		return m_endpoints.GetN();
+	}
+
+	uint32_t
+	FatTreeHelper::GetNSwitches() const
+	{
+		return m_layer1.GetN() + m_layer2.GetN() + m_layer3.GetN();
+	}
+
+	uint32_t
+	FatTreeHelper::GetNLinks() const
+	{
+		return m_endpoint_links.size() + m_switch_links.size();
+	}
+}
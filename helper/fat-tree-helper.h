@@ -0,0 +1,171 @@
+#ifndef FAT_TREE_HELPER_H
+#define FAT_TREE_HELPER_H
+
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/optical-helper.h"
+
+#include <vector>
+
+namespace ns3
+{
+	/**
+	 * @ingroup quantum-network
+	 * @class FatTreeHelper
+	 * @brief Builds three layer fat-trees of TimeNodes connected by optical
+	 * links.
+	 *
+	 * Endpoints attach to layer1 (edge) switches, every layer1 switch of a
+	 * cluster connects to every layer2 (aggregation) switch of the same
+	 * cluster, and layer2 switch i of every cluster connects to the layer3
+	 * (core) switches i * cores_per_agg ... (i + 1) * cores_per_agg - 1.
+	 * The clustered topology of examples/sim.cc uses one core per
+	 * aggregation switch, a k-ary fat-tree uses k/2.
+	 *
+	 * Link delays follow the physical layout used by the simulations, and the
+	 * longest path delay, PacketDelay and TimeslotDuration are derived from
+	 * them so the devices can be configured before anything is built. Install
+	 * runs in time linear in the number of links, every link gets its own
+	 * subnet from an OpticalAddressHelper.
+	 */
+	class FatTreeHelper
+	{
+		public:
+			FatTreeHelper();
+			~FatTreeHelper();
+
+			/**
+			 * @brief The helper used to create the links, set queue and
+			 * device attributes on it before calling Install.
+			 * @return The optical helper owned by this helper.
+			 */
+			OpticalHelper& GetOpticalHelper();
+			void SetClustered(uint32_t nodes_per_switch,
+							  uint32_t cluster_size,
+							  uint32_t num_clusters);
+			void SetKAry(uint32_t k);
+			void SetSkew(double skew);
+			/**
+			 * @brief The first link subnet and the prefix length of every
+			 * link subnet, 10.1.0.0/30 by default.
+			 * @param base the network address of the first link.
+			 * @param prefix_length the prefix length of each link.
+			 */
+			void SetAddressBase(Ipv4Address base, uint8_t prefix_length);
+			void SetLinkDelayUnit(Time t);
+			void SetSwitchPropagationDelay(Time t);
+			void SetPacketProcessing(Time t);
+			void SetControlTxTime(Time t);
+			void SetDataTxTime(Time t);
+			void SetPadding(Time packet_delay_padding, Time timeslot_padding);
+			/**
+			 * @brief Whether Install also sets the derived PacketDelay and
+			 * TimeslotDuration on the devices, off by default.
+			 * @param derive true to overwrite the device attributes.
+			 */
+			void SetDeriveTiming(bool derive);
+			/**
+			 * @brief Whether Install builds the layer3 (core) switches as
+			 * passive AWGRs instead of reconfiguring switches, off by
+			 * default. A core port reaches every other one when there are
+			 * at least num_clusters - 1 channels.
+			 * @param awgr true for AWGR core switches.
+			 */
+			void SetAwgr(bool awgr);
+
+			/**
+			 * @brief Create the nodes and links, install the internet stack,
+			 * assign addresses, mark endpoints and initialize the devices.
+			 */
+			void Install();
+			/**
+			 * @brief Install static up/down routes on every node instead of
+			 * running global routing. Switches spread destinations over
+			 * their layer2 switches (and cores) by destination block, and
+			 * endpoints are addressed in aligned blocks so one route covers
+			 * a whole layer1 switch or cluster. Call after Install.
+			 */
+			void PopulateRoutingTables();
+			/**
+			 * @brief Put the uplink ports of every layer1 and layer2 switch
+			 * in one equal-cost group, so reservations move to the least
+			 * occupied uplink. Call after Install.
+			 */
+			void EnableEcmp();
+
+			NodeContainer GetEndpoints() const;
+			NodeContainer GetLayer1() const;
+			NodeContainer GetLayer2() const;
+			NodeContainer GetLayer3() const;
+			NodeContainer GetAll() const;
+			/**
+			 * @brief The endpoint side interface of every endpoint link,
+			 * index i belongs to endpoint i.
+			 * @return The endpoint interfaces.
+			 */
+			Ipv4InterfaceContainer GetEndpointInterfaces() const;
+			uint32_t GetNEndpoints() const;
+			uint32_t GetNSwitches() const;
+			uint32_t GetNLinks() const;
+
+			Time GetEndpointLinkDelay(uint32_t n) const;
+			Time GetAggregationLinkDelay(uint32_t l1, uint32_t l2) const;
+			Time GetCoreLinkDelay(uint32_t i) const;
+			/**
+			 * @brief The propagation delay of the longest endpoint to
+			 * endpoint path, the TotalPropagationDelay of the devices.
+			 * @return The longest path delay.
+			 */
+			Time GetMaxPropagationDelay() const;
+			Time GetPacketDelay() const;
+			Time GetTimeslotDuration() const;
+		private:
+			NodeContainer CreateNodes(uint32_t count) const;
+			void AssignAddresses();
+			Ipv4Address GetBlockNetwork(uint32_t index, uint32_t subnets) const;
+			Ipv4Mask GetBlockMask(uint32_t subnets) const;
+			void AddRoute(uint32_t link, uint32_t side, uint32_t index,
+						  uint32_t subnets);
+			void AddDefaultRoute(const Ipv4InterfaceContainer& link,
+								 uint32_t side);
+
+			OpticalHelper m_optical;
+			InternetStackHelper m_stack;
+
+			uint32_t m_nodes_per_switch;
+			uint32_t m_cluster_size;
+			uint32_t m_num_clusters;
+			uint32_t m_cores_per_agg;
+			double m_skew;
+			Ipv4Address m_address_base;
+			uint8_t m_prefix_length;
+			Time m_link_delay_unit;
+			Time m_switch_propagation_delay;
+			Time m_packet_processing;
+			Time m_control_tx_time;
+			Time m_data_tx_time;
+			Time m_packet_delay_padding;
+			Time m_timeslot_padding;
+			bool m_derive_timing;
+			bool m_awgr;
+
+			NodeContainer m_endpoints;
+			NodeContainer m_layer1;
+			NodeContainer m_layer2;
+			NodeContainer m_layer3;
+			std::vector<NetDeviceContainer> m_endpoint_links;
+			std::vector<NetDeviceContainer> m_switch_links;
+			Ipv4InterfaceContainer m_endpoint_interfaces;
+			std::vector<Ipv4InterfaceContainer> m_endpoint_link_interfaces;
+			std::vector<Ipv4InterfaceContainer> m_switch_interfaces;
+			Ipv4Address m_endpoint_base;
+			uint32_t m_endpoint_block;
+			uint32_t m_cluster_block;
+	};
+}
+
+#endif
@@ -0,0 +1,83 @@
+#include "ns3/fluid-traffic-helper.h"
+#include "ns3/optical-channel.h"
+#include "ns3/optical-device.h"
+#include "ns3/optical-slot-clock.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+namespace ns3
+{
+	NS_LOG_COMPONENT_DEFINE("FluidTrafficHelper");
+
+	static void
+	SetPortLoad(Ptr<OpticalDevice> dev, double load)
+	{
+		Ptr<OpticalSlotClock> clock = 
+			dev->GetNode()->GetObject<OpticalSlotClock>();
+		NS_ASSERT_MSG(clock, "Node has no slot clock, call Initialize.");
+		Ptr<OpticalChannel> channel = 
+			DynamicCast<OpticalChannel>(dev->GetChannel());
+		for (uint8_t c = 1; c <= channel->GetNChannels(); c++)
+		{
+			clock->SetFluidLoad(dev->GetIfIndex(), c, load);
+		}
+	}
+
+	FluidTrafficHelper::FluidTrafficHelper()
+		: m_load(0.5)
+	{
+
+	}
+
+	FluidTrafficHelper::~FluidTrafficHelper()
+	{
+
+	}
+
+	void
+	FluidTrafficHelper::SetLoad(double load)
+	{
+		NS_ASSERT_MSG(load >= 0 && load <= 1, "Load must be in [0-1].");
+		m_load = load;
+	}
+
+	double
+	FluidTrafficHelper::GetLoad() const
+	{
+		return m_load;
+	}
+
+	void
+	FluidTrafficHelper::Install(NetDeviceContainer c, Time start, 
+								Time stop) const
+	{
+		NS_LOG_FUNCTION(this << start << stop);
+		NS_ASSERT_MSG(start <= stop, "Load stops before it starts.");
+		for (uint32_t i = 0; i < c.GetN(); i++)
+		{
+			Ptr<OpticalDevice> dev = DynamicCast<OpticalDevice>(c.Get(i));
+			NS_ASSERT_MSG(dev, "Should only pass in OpticalDevice.");
+			Simulator::Schedule(start, &SetPortLoad, dev, m_load);
+			Simulator::Schedule(stop, &SetPortLoad, dev, 0.0);
+		}
+	}
+
+	void
+	FluidTrafficHelper::Install(NodeContainer c, Time start, Time stop) const
+	{
+		NetDeviceContainer devices;
+		for (auto it = c.Begin(); it != c.End(); ++it)
+		{
+			for (uint32_t i = 0; i < (*it)->GetNDevices(); i++)
+			{
+				Ptr<NetDevice> device = (*it)->GetDevice(i);
+				if (DynamicCast<OpticalDevice>(device))
+				{
+					devices.Add(device);
+				}
+			}
+		}
+		Install(devices, start, stop);
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef FLUID_TRAFFIC_HELPER_H
+#define FLUID_TRAFFIC_HELPER_H
+
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+
+namespace ns3
+{
+	/**
+	 * @ingroup quantum-network
+	 * @class FluidTrafficHelper
+	 * @brief Loads optical ports with fluid background traffic.
+	 *
+	 * Instead of generating classical packets, every data channel of a port
+	 * holds a fixed fraction of each timeslot between the start and stop
+	 * times, so reservations only get the capacity that is left. The load is
+	 * kept in the node's OpticalSlotClock and costs two events per port.
+	 */
+	class FluidTrafficHelper
+	{
+		public:
+			FluidTrafficHelper();
+			~FluidTrafficHelper();
+
+			/**
+			 * @brief The fraction of each slot held by background traffic.
+			 * @param load the fraction [0-1], 0.5 by default.
+			 */
+			void SetLoad(double load);
+			double GetLoad() const;
+			/**
+			 * @brief Load the given ports from start until stop, call after
+			 * OpticalHelper::Initialize.
+			 * @param c the optical devices.
+			 * @param start the time the load is applied.
+			 * @param stop the time the load is removed.
+			 */
+			void Install(NetDeviceContainer c, Time start, Time stop) const;
+			/**
+			 * @brief Load every optical port of the nodes.
+			 * @param c the nodes.
+			 * @param start the time the load is applied.
+			 * @param stop the time the load is removed.
+			 */
+			void Install(NodeContainer c, Time start, Time stop) const;
+		private:
+			double m_load;
+	};
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "ns3/optical-address-helper.h"
+
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-interface-address.h"
+#include "ns3/log.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+
+namespace ns3
+{
+	NS_LOG_COMPONENT_DEFINE("OpticalAddressHelper");
+
+	OpticalAddressHelper::OpticalAddressHelper()
+	{
+		SetBase(Ipv4Address("10.0.0.0"), 30);
+	}
+
+	OpticalAddressHelper::OpticalAddressHelper(Ipv4Address base, 
+											   uint8_t prefix_length)
+	{
+		SetBase(base, prefix_length);
+	}
+
+	OpticalAddressHelper::~OpticalAddressHelper()
+	{
+
+	}
+
+	void
+	OpticalAddressHelper::SetBase(Ipv4Address base, uint8_t prefix_length)
+	{
+		NS_LOG_FUNCTION(this << base << (int)prefix_length);
+		NS_ASSERT_MSG(prefix_length >= 8 && prefix_length <= 30,
+					  "Link prefix length must be between 8 and 30.");
+		m_prefix_length = prefix_length;
+		m_mask = 0xffffffff << (32 - prefix_length);
+		m_subnet_size = 1u << (32 - prefix_length);
+		NS_ASSERT_MSG((base.Get() & ~m_mask) == 0,
+					  "Base " << base << " is not a network address.");
+		m_base = base;
+		m_next = base.Get();
+		m_allocated = 0;
+	}
+
+	Ipv4InterfaceContainer
+	OpticalAddressHelper::Assign(const NetDeviceContainer& c)
+	{
+		NS_LOG_FUNCTION(this);
+		NS_ASSERT_MSG(c.GetN() <= m_subnet_size - 2,
+					  "Too many devices for a /" << (int)m_prefix_length);
+		NS_ASSERT_MSG(m_next + m_subnet_size <= (1ULL << 32),
+					  "Address range exhausted.");
+		Ipv4Mask mask(m_mask);
+		Ipv4InterfaceContainer container;
+		for (uint32_t i = 0; i < c.GetN(); i++)
+		{
+			Ptr<NetDevice> device = c.Get(i);
+			Ptr<Node> node = device->GetNode();
+			NS_ASSERT_MSG(node, "Device is not attached to a node.");
+			Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+			NS_ASSERT_MSG(ipv4, "Install the internet stack first.");
+			int32_t interface = ipv4->GetInterfaceForDevice(device);
+			if (interface == -1)
+			{
+				interface = ipv4->AddInterface(device);
+			}
+			Ipv4Address host(static_cast<uint32_t>(m_next + i + 1));
+			Ipv4InterfaceAddress address(host, mask);
+			ipv4->AddAddress(interface, address);
+			ipv4->SetMetric(interface, 1);
+			ipv4->SetUp(interface);
+			container.Add(ipv4, interface);
+		}
+		m_next += m_subnet_size;
+		m_allocated++;
+		return container;
+	}
+
+	Ipv4InterfaceContainer
+	OpticalAddressHelper::Assign(const std::vector<NetDeviceContainer>& links)
+	{
+		NS_LOG_FUNCTION(this << links.size());
+		Ipv4InterfaceContainer container;
+		for (const auto& link : links)
+		{
+			container.Add(Assign(link));
+		}
+		return container;
+	}
+
+	void
+	OpticalAddressHelper::AlignTo(uint32_t subnets)
+	{
+		NS_LOG_FUNCTION(this << subnets);
+		NS_ASSERT_MSG(subnets > 0 && (subnets & (subnets - 1)) == 0,
+					  "Block size must be a power of two.");
+		uint64_t block = static_cast<uint64_t>(subnets) * m_subnet_size;
+		uint64_t offset = m_next - m_base.Get();
+		offset = ((offset + block - 1) / block) * block;
+		m_next = m_base.Get() + offset;
+	}
+
+	Ipv4Address
+	OpticalAddressHelper::GetNextNetwork() const
+	{
+		return Ipv4Address(static_cast<uint32_t>(m_next));
+	}
+
+	Ipv4Mask
+	OpticalAddressHelper::GetMask() const
+	{
+		return Ipv4Mask(m_mask);
+	}
+
+	uint32_t
+	OpticalAddressHelper::GetNAllocated() const
+	{
+		return m_allocated;
+	}
+}
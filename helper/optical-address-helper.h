@@ -0,0 +1,66 @@
+#ifndef OPTICAL_ADDRESS_HELPER_H
+#define OPTICAL_ADDRESS_HELPER_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/net-device-container.h"
+
+#include <vector>
+
+namespace ns3
+{
+	/**
+	 * @ingroup quantum-network
+	 * @class OpticalAddressHelper
+	 * @brief Assigns consecutive small subnets to point-to-point optical
+	 * links without string parsing.
+	 *
+	 * Every NetDeviceContainer passed to Assign gets the next subnet of the
+	 * configured prefix length, counted up from the base. The default /30
+	 * gives each link a network, two host and a broadcast address; /31 is
+	 * not supported because ns-3 treats the upper address of a /31 as the
+	 * subnet broadcast. Unlike Ipv4AddressHelper the addresses are not
+	 * registered with the global Ipv4AddressGenerator, so the range should
+	 * not overlap ranges handed out by other helpers.
+	 */
+	class OpticalAddressHelper
+	{
+		public:
+			OpticalAddressHelper();
+			OpticalAddressHelper(Ipv4Address base, uint8_t prefix_length);
+			~OpticalAddressHelper();
+
+			void SetBase(Ipv4Address base, uint8_t prefix_length);
+			/**
+			 * @brief Assign the next subnet to the devices of one link.
+			 * @param c the devices sharing the link.
+			 * @return The interfaces in the order of the devices.
+			 */
+			Ipv4InterfaceContainer Assign(const NetDeviceContainer& c);
+			/**
+			 * @brief Assign one subnet per link in a single pass.
+			 * @param links the devices of every link.
+			 * @return The interfaces of all links, in link order.
+			 */
+			Ipv4InterfaceContainer Assign(
+				const std::vector<NetDeviceContainer>& links);
+			/**
+			 * @brief Skip ahead so the next subnet starts a block of the
+			 * given number of subnets.
+			 * @param subnets the block size, a power of two.
+			 */
+			void AlignTo(uint32_t subnets);
+			Ipv4Address GetNextNetwork() const;
+			Ipv4Mask GetMask() const;
+			uint32_t GetNAllocated() const;
+		private:
+			Ipv4Address m_base;
+			uint8_t m_prefix_length;
+			uint32_t m_mask;
+			uint32_t m_subnet_size;
+			uint64_t m_next;
+			uint32_t m_allocated;
+	};
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "ns3/optical-helper.h"
+#include "ns3/optical-awgr.h"
 #include "ns3/optical-device.h"
 #include "ns3/optical-channel.h"
 #include "ns3/net-device-container.h"
@@ -86,6 +87,42 @@ namespace ns3
 		return container;
 	}
 
+	NetDeviceContainer
+	OpticalHelper::InstallShared(NodeContainer c)
+	{
+		NS_ASSERT_MSG(c.GetN() >= 2, "A shared channel needs two nodes.");
+		NetDeviceContainer container;
+		Ptr<OpticalChannel> channel = 
+			m_channel_factory.Create<OpticalChannel>();
+		for (auto it = c.Begin(); it != c.End(); ++it)
+		{
+			Ptr<TimeNode> node = (*it)->GetObject<TimeNode>();
+			NS_ASSERT_MSG(node, "Should only pass in TimeNode.");
+			Ptr<OpticalDevice> dev = m_device_factory.Create<OpticalDevice>();
+			dev->SetAddress(Mac48Address::Allocate());
+			Ptr<Queue<Packet>> control_queue = 
+				m_queue_factory.Create<Queue<Packet>>();
+			dev->SetControlQueue(control_queue);
+			dev->SetDeviceId(m_dev_count++);
+			node->AddDevice(dev);
+			dev->Attach(channel);
+			container.Add(dev);
+		}
+		return container;
+	}
+
+	void
+	OpticalHelper::InstallAwgr(NodeContainer c)
+	{
+		for (auto it = c.Begin(); it != c.End(); ++it)
+		{
+			if (!(*it)->GetObject<OpticalAwgr>())
+			{
+				(*it)->AggregateObject(CreateObject<OpticalAwgr>());
+			}
+		}
+	}
+
 	NetDeviceContainer
 	OpticalHelper::Install(Ptr<Node> a, Ptr<Node> b)
 	{
@@ -26,6 +26,19 @@ namespace ns3
 			NetDeviceContainer Install(NodeContainer c);
 			NetDeviceContainer Install(Ptr<TimeNode> a, Ptr<TimeNode> b);
 			NetDeviceContainer Install(Ptr<Node> a, Ptr<Node> b);
+			/**
+			 * @brief Attach one new device on every node to a single
+			 * shared (star coupler) channel.
+			 * @param c the nodes, at least two.
+			 * @return The devices, in node order.
+			 */
+			NetDeviceContainer InstallShared(NodeContainer c);
+			/**
+			 * @brief Turn the nodes into passive AWGR switches that route
+			 * by ingress port and wavelength, call before Initialize.
+			 * @param c the switch nodes.
+			 */
+			void InstallAwgr(NodeContainer c);
 			NetDeviceContainer SetEndpoints(NodeContainer c);
 			NetDeviceContainer SetEndpoints(Ptr<TimeNode> a);
 			void Initialize(NodeContainer c);
@@ -0,0 +1,95 @@
+#include "ns3/optical-awgr.h"
+
+#include "ns3/log.h"
+#include "ns3/optical-device.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+	NS_LOG_COMPONENT_DEFINE("OpticalAwgr");
+	NS_OBJECT_ENSURE_REGISTERED(OpticalAwgr);
+
+	TypeId
+	OpticalAwgr::GetTypeId()
+	{
+		static TypeId tid =
+			TypeId("ns3::OpticalAwgr")
+				.SetParent<Object>()
+				.SetGroupName("QuantumNetwork")
+				.AddConstructor<OpticalAwgr>();
+		return tid;
+	}
+
+	OpticalAwgr::OpticalAwgr()
+		: m_ports(0),
+		  m_width(0)
+	{
+		NS_LOG_FUNCTION(this);
+	}
+
+	OpticalAwgr::~OpticalAwgr()
+	{
+		NS_LOG_FUNCTION(this);
+	}
+
+	void
+	OpticalAwgr::Build(Ptr<Node> node)
+	{
+		NS_LOG_FUNCTION(this << node);
+		std::vector<uint32_t> ports;
+		uint8_t channels = 0;
+		for (uint32_t i = 0; i < node->GetNDevices(); i++)
+		{
+			Ptr<OpticalDevice> dev =
+				DynamicCast<OpticalDevice>(node->GetDevice(i));
+			if (dev && dev->GetChannel())
+			{
+				ports.push_back(i);
+				Ptr<OpticalChannel> channel =
+					DynamicCast<OpticalChannel>(dev->GetChannel());
+				channels = std::max(channels, channel->GetNChannels());
+			}
+		}
+		m_ports = ports.size();
+		m_width = channels + 1;
+		m_table.assign(node->GetNDevices() * m_width, -1);
+		for (uint32_t i = 0; i < m_ports; i++)
+		{
+			// Channel 0 carries control and is never switched
+			for (uint32_t c = 1; c < m_width; c++)
+			{
+				uint32_t out = (i + c) % m_ports;
+				if (out != i)
+				{
+					m_table[ports[i] * m_width + c] = ports[out];
+				}
+			}
+		}
+	}
+
+	int
+	OpticalAwgr::GetRoute(uint32_t in_ifindex, uint8_t channel) const
+	{
+		size_t index = static_cast<size_t>(in_ifindex) * m_width + channel;
+		if (channel >= m_width || index >= m_table.size())
+		{
+			return -1;
+		}
+		return m_table[index];
+	}
+
+	uint32_t
+	OpticalAwgr::GetNPorts() const
+	{
+		return m_ports;
+	}
+
+	MemoryUsage
+	OpticalAwgr::GetMemoryUsage() const
+	{
+		MemoryUsage usage;
+		usage.push_back({"m_table", memory::VectorBytes(m_table)});
+		return usage;
+	}
+}
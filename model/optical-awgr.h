@@ -0,0 +1,55 @@
+#ifndef OPTICAL_AWGR_H
+#define OPTICAL_AWGR_H
+
+#include "ns3/node.h"
+#include "ns3/object.h"
+#include "ns3/optical-memory.h"
+
+#include <vector>
+
+namespace ns3
+{
+	/**
+	 * @ingroup quantum-network
+	 * @class OpticalAwgr
+	 * @brief Passive arrayed waveguide grating router, aggregated to a
+	 * switch node.
+	 *
+	 * The output port is fixed by the input port and the wavelength: with the
+	 * n optical ports of the node in ifindex order, a burst entering port i
+	 * on channel c leaves through port (i + c) mod n, and is dropped when
+	 * that is port i itself. The grating never reconfigures, so the devices
+	 * of the node skip the slot calendar and route with one table lookup.
+	 */
+	class OpticalAwgr : public Object
+	{
+		public:
+			static TypeId GetTypeId();
+			OpticalAwgr();
+			~OpticalAwgr() override;
+
+			/**
+			 * @brief Build the routing table from the optical ports of the
+			 * node, call once all of its devices are attached.
+			 * @param node the switch node.
+			 */
+			void Build(Ptr<Node> node);
+			/**
+			 * @brief The egress port of a burst.
+			 * @param in_ifindex the ifindex of the ingress port.
+			 * @param channel the wavelength of the burst.
+			 * @return The egress ifindex, or -1 if the burst is dropped.
+			 */
+			int GetRoute(uint32_t in_ifindex, uint8_t channel) const;
+			uint32_t GetNPorts() const;
+
+			MemoryUsage GetMemoryUsage() const;
+		private:
+			uint32_t m_ports;
+			uint32_t m_width;
+			// [ifindex * m_width + channel], egress ifindex or -1
+			std::vector<int> m_table;
+	};
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef OPTICAL_BYTE_CODEC_H
+#define OPTICAL_BYTE_CODEC_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace ns3
+{
+	/*
+	Little-endian load and store of the integer fields carried in control,
+	AWK/NACK and application payloads. Loads and stores go through memcpy so
+	they compile to a single unaligned move on little-endian hosts, and are
+	byte swapped on big-endian hosts so the wire format stays the same.
+	*/
+	namespace codec
+	{
+		inline uint16_t
+		ToLittleEndian(uint16_t value)
+		{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			return __builtin_bswap16(value);
+#else
+			return value;
+#endif
+		}
+
+		inline uint32_t
+		ToLittleEndian(uint32_t value)
+		{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			return __builtin_bswap32(value);
+#else
+			return value;
+#endif
+		}
+
+		inline uint64_t
+		ToLittleEndian(uint64_t value)
+		{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			return __builtin_bswap64(value);
+#else
+			return value;
+#endif
+		}
+
+		template <typename T>
+		inline T
+		Load(const uint8_t* buffer, int offset)
+		{
+			T value;
+			std::memcpy(&value, buffer + offset, sizeof(T));
+			return ToLittleEndian(value);
+		}
+
+		template <typename T>
+		inline void
+		Store(uint8_t* buffer, int offset, T value)
+		{
+			value = ToLittleEndian(value);
+			std::memcpy(buffer + offset, &value, sizeof(T));
+		}
+
+		inline uint16_t
+		LoadUint16(const uint8_t* buffer, int offset)
+		{
+			return Load<uint16_t>(buffer, offset);
+		}
+
+		inline uint32_t
+		LoadUint32(const uint8_t* buffer, int offset)
+		{
+			return Load<uint32_t>(buffer, offset);
+		}
+
+		inline uint64_t
+		LoadUint64(const uint8_t* buffer, int offset)
+		{
+			return Load<uint64_t>(buffer, offset);
+		}
+
+		inline void
+		StoreUint16(uint8_t* buffer, int offset, uint16_t value)
+		{
+			Store<uint16_t>(buffer, offset, value);
+		}
+
+		inline void
+		StoreUint32(uint8_t* buffer, int offset, uint32_t value)
+		{
+			Store<uint32_t>(buffer, offset, value);
+		}
+
+		inline void
+		StoreUint64(uint8_t* buffer, int offset, uint64_t value)
+		{
+			Store<uint64_t>(buffer, offset, value);
+		}
+	}
+}
+
+#endif
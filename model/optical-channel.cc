@@ -1,10 +1,12 @@
 #include "ns3/optical-channel.h"
 #include "ns3/optical-device.h"
 #include "ns3/optical-tag.h"
+#include "ns3/optical-profiler.h"
 
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
 
 #include <vector>
 
@@ -36,7 +38,14 @@ namespace ns3
 								"Trace Source indicating a packet collision",
 								MakeTraceSourceAccessor(
 									&OpticalChannel::m_collisionTrace),
-								"ns3::OpticalChannel::TracedCallback");
+								"ns3::OpticalChannel::TracedCallback")
+				.AddAttribute("MemoryFootprint",
+							  "Estimated heap bytes held by the channel.",
+							  TypeId::ATTR_GET,
+							  UintegerValue(0),
+							  MakeUintegerAccessor(
+							  		&OpticalChannel::GetMemoryFootprint),
+							  MakeUintegerChecker<uint64_t>());
 		return tid;
 	}
 
@@ -49,10 +58,8 @@ namespace ns3
 		NS_LOG_FUNCTION(this);
 		for (int i = 0; i <= m_num_channels; i++)
 		{
-			m_dev0_channels.push_back(0);
-			m_dev1_channels.push_back(0);
-			std::map<uint32_t, Ptr<Packet>> packet_map;
-			m_packet_map.push_back(packet_map);
+			m_packet_map.emplace_back();
+			m_channel_load.push_back(0);
 		}
 	}
 
@@ -61,28 +68,105 @@ namespace ns3
 		NS_LOG_FUNCTION(this);
 	}
 
+	void
+	OpticalChannel::DoDispose()
+	{
+		NS_LOG_FUNCTION(this);
+		m_devices.clear();
+		m_device_index.clear();
+		Channel::DoDispose();
+	}
+
 	void
 	OpticalChannel::Attach(Ptr<OpticalDevice> device)
 	{
 		NS_LOG_FUNCTION(this << device);
-		NS_ASSERT_MSG(m_num_devices < 2, "Only two devices permitted");
 		NS_ASSERT_MSG(device, "Device did not exist");
+		NS_ASSERT_MSG(m_device_index.find(PeekPointer(device)) == 
+					  m_device_index.end(), "Device already attached");
 
-		if (m_num_devices == 0)
+		m_device_index.insert({PeekPointer(device), m_num_devices});
+		m_devices.push_back(device);
+		m_dev_channels.push_back(std::vector<uint8_t>(m_num_channels + 1, 0));
+		m_num_devices++;
+
+		if (m_num_devices == 2)
 		{
-			m_dev0 = device;
+			m_devices[0]->NotifyLinkUp();
+			m_devices[1]->NotifyLinkUp();
 		}
-		else
+		else if (m_num_devices > 2)
 		{
-			m_dev1 = device;
+			device->NotifyLinkUp();
 		}
-		m_num_devices++;
+	}
 
+	std::size_t
+	OpticalChannel::GetDeviceIndex(Ptr<const OpticalDevice> device) const
+	{
+		auto iter = m_device_index.find(PeekPointer(device));
+		NS_ASSERT_MSG(iter != m_device_index.end(), "Device not attached.");
+		return iter->second;
+	}
+
+	std::size_t
+	OpticalChannel::GetDestination(std::size_t src, uint8_t channel) const
+	{
 		if (m_num_devices == 2)
 		{
-			m_dev0->NotifyLinkUp();
-			m_dev1->NotifyLinkUp();
+			return 1 - src;
+		}
+		return BROADCAST;
+	}
+
+	std::size_t
+	OpticalChannel::FindDevice(Mac48Address address) const
+	{
+		if (address.IsBroadcast())
+		{
+			return BROADCAST;
+		}
+		for (std::size_t i = 0; i < m_num_devices; i++)
+		{
+			if (Mac48Address::ConvertFrom(m_devices[i]->GetAddress()) == 
+				address)
+			{
+				return i;
+			}
+		}
+		return BROADCAST;
+	}
+
+	void
+	OpticalChannel::Deliver(Ptr<Packet> p, std::size_t dest, Time tx_time, 
+							bool data, bool copy)
+	{
+		Ptr<OpticalDevice> dest_dev = m_devices[dest];
+		// Switches see the start of a burst, endpoints receive it whole
+		Time delay = (!data || dest_dev->IsEndpoint()) ? 
+			tx_time + m_delay : m_delay;
+		if (copy)
+		{
+			Simulator::ScheduleWithContext(dest_dev->GetNode()->GetId(),
+										   delay,
+										   &OpticalChannel::DeliverCopy,
+										   this,
+										   dest_dev,
+										   p);
+			return;
 		}
+		Simulator::ScheduleWithContext(dest_dev->GetNode()->GetId(),
+									   delay,
+									   &OpticalDevice::Receive,
+									   dest_dev,
+									   p);
+	}
+
+	void
+	OpticalChannel::DeliverCopy(Ptr<OpticalDevice> dest, Ptr<Packet> p)
+	{
+		// Copied on arrival so collisions marked during the burst are kept
+		dest->Receive(p->Copy());
 	}
 
 	void
@@ -91,7 +175,7 @@ namespace ns3
 								  Time txTime)
 	{
 		NS_LOG_FUNCTION(this << p << src << txTime);
-		NS_ASSERT_MSG(m_num_devices == 2, "Channel should have 2 devices");
+		NS_ASSERT_MSG(m_num_devices >= 2, "Channel needs at least 2 devices");
 
 		OpticalTag tag;
 		bool found_tag = p->PeekPacketTag(tag);
@@ -99,13 +183,27 @@ namespace ns3
 		uint8_t channel = tag.GetChannel();
 		NS_ASSERT_MSG(channel == 0, "Should be control channel.");
 
-		Ptr<OpticalDevice> dest_dev = m_dev0 == src ? m_dev1 : m_dev0;
-
-		Simulator::ScheduleWithContext(dest_dev->GetNode()->GetId(),
-									   txTime + m_delay,
-									   &OpticalDevice::Receive,
-									   dest_dev,
-									   p);
+		std::size_t src_idx = GetDeviceIndex(src);
+		std::size_t dest = GetDestination(src_idx, channel);
+		if (dest == BROADCAST)
+		{
+			dest = FindDevice(tag.GetDestination());
+		}
+		if (dest != BROADCAST)
+		{
+			if (dest != src_idx)
+			{
+				Deliver(p, dest, txTime, false, false);
+			}
+			return;
+		}
+		for (std::size_t i = 0; i < m_num_devices; i++)
+		{
+			if (i != src_idx)
+			{
+				Deliver(p->Copy(), i, txTime, false, false);
+			}
+		}
 	}
 
 	void
@@ -114,23 +212,23 @@ namespace ns3
 								Time tx_time)
 	{
 		NS_LOG_FUNCTION(this << p << src << tx_time);
-		NS_ASSERT_MSG(m_num_devices == 2, "Channel should have 2 devices");
+		OpticalProfiler::Scope profile(OpticalProfiler::CHANNEL_PASS_THROUGH,
+									   src->IsEndpoint());
+		NS_ASSERT_MSG(m_num_devices >= 2, "Channel needs at least 2 devices");
 		OpticalTag tag;
 		bool found_tag = p->PeekPacketTag(tag);
 		NS_ASSERT_MSG(found_tag, "Did not find the optical tag.");
 		uint8_t channel = tag.GetChannel();
 		uint32_t id = tag.GetMsgId();
+		Mac48Address addressed = tag.GetDestination();
 		NS_ASSERT_MSG(channel <= m_num_channels && channel > 0, 
 				  	  "That channel does not exist");
 
-		std::vector<uint8_t>& src_channels = 
-				m_dev0 == src ? m_dev0_channels : m_dev1_channels;
-		std::vector<uint8_t>& dest_channels = 
-				m_dev0 == src ? m_dev1_channels : m_dev0_channels;
-		Ptr<OpticalDevice> dest_dev = m_dev0 == src ? m_dev1 : m_dev0;
+		std::size_t src_idx = GetDeviceIndex(src);
+		std::vector<uint8_t>& src_channels = m_dev_channels[src_idx];
 
 		m_packet_map[channel].insert({id, p});
-		if (dest_channels[channel] != 0)
+		if (m_channel_load[channel] > src_channels[channel])
 		{
 			m_collisionTrace(src, p);
 			for (auto& item : m_packet_map[channel])
@@ -142,6 +240,7 @@ namespace ns3
 			}
 		}
 		src_channels[channel]++;
+		m_channel_load[channel]++;
 		
 		Simulator::Schedule(tx_time + m_delay,
 							&OpticalChannel::PassThroughFinished,
@@ -149,21 +248,26 @@ namespace ns3
 							src,
 							p,
 							channel);
-		if (dest_dev->IsEndpoint())
+		std::size_t dest = GetDestination(src_idx, channel);
+		if (dest == BROADCAST)
 		{
-			Simulator::ScheduleWithContext(dest_dev->GetNode()->GetId(),
-										   tx_time + m_delay,
-										   &OpticalDevice::Receive,
-										   dest_dev,
-										   p);
+			dest = FindDevice(addressed);
 		}
-		else
+		if (dest != BROADCAST)
 		{
-			Simulator::ScheduleWithContext(dest_dev->GetNode()->GetId(),
-										   m_delay,
-										   &OpticalDevice::Receive,
-										   dest_dev,
-										   p);
+			if (dest != src_idx)
+			{
+				Deliver(p, dest, tx_time, true, false);
+			}
+			return;
+		}
+		// Receivers strip headers, so each gets its own copy
+		for (std::size_t i = 0; i < m_num_devices; i++)
+		{
+			if (i != src_idx)
+			{
+				Deliver(p, i, tx_time, true, true);
+			}
 		}
 	}
 
@@ -178,10 +282,11 @@ namespace ns3
 	OpticalChannel::GetDevice(std::size_t i) const
 	{
 		NS_LOG_FUNCTION(this << i);
-		if (i == 0)
-			return m_dev0;
-		else
-			return m_dev1;
+		if (i >= m_num_devices)
+		{
+			return nullptr;
+		}
+		return m_devices[i];
 	}
 
 	uint8_t
@@ -196,16 +301,17 @@ namespace ns3
 	{
 		NS_LOG_FUNCTION(this);
 		NS_ASSERT_MSG(channels > 0, "Requires at least one channel");
-		m_dev0_channels.clear();
-		m_dev1_channels.clear();
 		m_packet_map.clear();
+		m_channel_load.clear();
 		m_num_channels = channels;
 		for (int i = 0; i <= channels; i++)
 		{
-			m_dev0_channels.push_back(0);
-			m_dev1_channels.push_back(0);
-			std::map<uint32_t, Ptr<Packet>> packet_map;
-			m_packet_map.push_back(packet_map);
+			m_packet_map.emplace_back();
+			m_channel_load.push_back(0);
+		}
+		for (auto& dev_channels : m_dev_channels)
+		{
+			dev_channels.assign(channels + 1, 0);
 		}
 	}
 
@@ -216,6 +322,39 @@ namespace ns3
 		return m_delay;
 	}
 
+	MemoryUsage
+	OpticalChannel::GetMemoryUsage() const
+	{
+		MemoryUsage usage;
+		uint64_t packet_map = memory::VectorBytes(m_packet_map);
+		for (const auto& map : m_packet_map)
+		{
+			packet_map += memory::MapBytes(map);
+			for (const auto& item : map)
+			{
+				packet_map += sizeof(Packet) + item.second->GetSize();
+			}
+		}
+		usage.push_back({"m_packet_map", packet_map});
+		uint64_t dev_channels = memory::VectorBytes(m_dev_channels) + 
+			memory::VectorBytes(m_channel_load);
+		for (const auto& channels : m_dev_channels)
+		{
+			dev_channels += memory::VectorBytes(channels);
+		}
+		usage.push_back({"m_dev_channels", dev_channels});
+		usage.push_back({"m_devices", memory::VectorBytes(m_devices) + 
+			m_device_index.size() * (sizeof(std::pair<const OpticalDevice*, 
+				std::size_t>) + memory::LIST_NODE_OVERHEAD)});
+		return usage;
+	}
+
+	uint64_t
+	OpticalChannel::GetMemoryFootprint() const
+	{
+		return memory::TotalBytes(GetMemoryUsage());
+	}
+
 	void
 	OpticalChannel::PassThroughFinished(Ptr<OpticalDevice> src, 
 									 	Ptr<Packet> packet,
@@ -227,10 +366,11 @@ namespace ns3
 		NS_ASSERT_MSG(found_tag, "Did not find the optical tag.");
 		uint32_t id = tag.GetMsgId();
 		std::vector<uint8_t>& src_channels = 
-				m_dev0 == src ? m_dev0_channels : m_dev1_channels;
+				m_dev_channels[GetDeviceIndex(src)];
 		NS_ASSERT_MSG(src_channels[channel] > 0, 
 				  "Error, transmission finished on unused channel");
 		src_channels[channel]--;
+		m_channel_load[channel]--;
 		NS_ASSERT_MSG(!m_packet_map[channel].empty(), 
 					  "Should have packets in queue.");
 		auto iter = m_packet_map[channel].find(id);
@@ -2,8 +2,10 @@
 #define OPTICAL_CHANNEL_H
 
 #include "ns3/channel.h"
+#include "ns3/mac48-address.h"
 #include "ns3/nstime.h"
 #include "ns3/traced-callback.h"
+#include "ns3/optical-memory.h"
 #include "ns3/packet.h"
 #include "ns3/ptr.h"
 #include "ns3/traced-callback.h"
@@ -11,14 +13,29 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <unordered_map>
 
 namespace ns3
 {
 	class OpticalDevice;
 
+	/**
+	 * @ingroup quantum-network
+	 * @class OpticalChannel
+	 * @brief Optical medium connecting two or more optical devices.
+	 *
+	 * Two devices form a point to point link. With more devices the channel
+	 * is a passive star coupler: a transmission reaches every other device
+	 * and two sources on the same wavelength collide. Frames are only
+	 * delivered to the port named in their optical tag, and to every other
+	 * port when the sender could not resolve one. Subclasses pick the
+	 * destination per source port and wavelength through GetDestination.
+	 */
 	class OpticalChannel : public Channel
 	{
 		public:
+			static constexpr std::size_t BROADCAST = static_cast<std::size_t>(-1);
+
 			static TypeId GetTypeId();
 			OpticalChannel();
 			~OpticalChannel();
@@ -34,19 +51,50 @@ namespace ns3
 			uint8_t GetNChannels() const;
 			void SetNChannels(uint8_t channels);
 			Time GetDelay() const;
+			/**
+			 * @brief The index a device was attached at, in constant time.
+			 * @param device an attached device.
+			 * @return The index of the device.
+			 */
+			std::size_t GetDeviceIndex(Ptr<const OpticalDevice> device) const;
+			/**
+			 * @brief The device a transmission from src on a wavelength
+			 * reaches.
+			 * @param src the index of the sending device.
+			 * @param channel the wavelength, 0 for the control channel.
+			 * @return The destination index, or BROADCAST for every other
+			 * device.
+			 */
+			virtual std::size_t GetDestination(std::size_t src, 
+											   uint8_t channel) const;
+			/**
+			 * @brief The index of the device with an address.
+			 * @param address the MAC address of the device.
+			 * @return The index, or BROADCAST if no device has it.
+			 */
+			std::size_t FindDevice(Mac48Address address) const;
+			MemoryUsage GetMemoryUsage() const;
+			uint64_t GetMemoryFootprint() const;
 		protected:
+			void DoDispose() override;
 			void PassThroughFinished(Ptr<OpticalDevice> src,
 									 Ptr<Packet> packet,
 									 uint8_t channel);
+			void Deliver(Ptr<Packet> p, std::size_t dest, Time tx_time, 
+						 bool data, bool copy);
+			void DeliverCopy(Ptr<OpticalDevice> dest, Ptr<Packet> p);
 		private:
 			Time m_delay;
 			std::size_t m_num_devices;
 			uint8_t m_num_channels;
-			Ptr<OpticalDevice> m_dev0;
-			Ptr<OpticalDevice> m_dev1;
-			std::vector<std::map<uint32_t, Ptr<Packet>>> m_packet_map;
-			std::vector<uint8_t> m_dev0_channels;
-			std::vector<uint8_t> m_dev1_channels;
+			std::vector<Ptr<OpticalDevice>> m_devices;
+			std::unordered_map<const OpticalDevice*, std::size_t> 
+				m_device_index;
+			std::vector<memory::PoolMap<uint32_t, Ptr<Packet>>> m_packet_map;
+			// [device][channel] transmissions in progress from the device
+			std::vector<std::vector<uint8_t>> m_dev_channels;
+			// [channel] transmissions in progress from every device
+			std::vector<uint32_t> m_channel_load;
 
 			TracedCallback<Ptr<const OpticalDevice>, Ptr<const Packet>> 
 				m_collisionTrace;
@@ -1,29 +1,46 @@
 #include "ns3/optical-device.h"
+#include "ns3/optical-byte-codec.h"
 #include "ns3/optical-channel.h"
 #include "ns3/optical-control-header.h"
 #include "ns3/optical-data-header.h"
 #include "ns3/optical-header.h"
 #include "ns3/optical-tag.h"
+#include "ns3/optical-profiler.h"
 #include "ns3/time-node.h"
 
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
 #include "ns3/log.h"
 #include "ns3/mac48-address.h"
+#include "ns3/node-list.h"
 #include "ns3/pointer.h"
 #include "ns3/queue.h"
 #include "ns3/simulator.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
 #include "ns3/packet.h"
+#include "ns3/ipv4.h"
 #include "ns3/ipv4-header.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-protocol.h"
 #include "ns3/udp-header.h"
 #include "ns3/socket.h"
 #include "ns3/ipv4-packet-info-tag.h"
 
+#include <algorithm>
+#include <limits>
 #include <map>
 #include <vector>
 #include <random>
 #include <ctime>
 
+// Function logging in the per-packet paths can be compiled out on its own
+#ifdef QUANTUM_NETWORK_NO_HOT_LOG
+#define OPTICAL_HOT_LOG_FUNCTION(parameters)
+#else
+#define OPTICAL_HOT_LOG_FUNCTION(parameters) NS_LOG_FUNCTION(parameters)
+#endif
+
 namespace ns3
 {
 	NS_LOG_COMPONENT_DEFINE("OpticalDevice");
@@ -131,6 +148,71 @@ namespace ns3
 							  MakeDoubleAccessor(
 							  		&OpticalDevice::m_failure_rate),
 							  MakeDoubleChecker<double>())
+				.AddAttribute("MaxReceivedHistory",
+							  "The number of received ids an endpoint keeps "
+							  "for collision checks, 0 keeps all of them.",
+							  UintegerValue(0),
+							  MakeUintegerAccessor(
+							  		&OpticalDevice::m_max_received),
+							  MakeUintegerChecker<uint32_t>())
+				.AddAttribute("MemoryFootprint",
+							  "Estimated heap bytes held by the device.",
+							  TypeId::ATTR_GET,
+							  UintegerValue(0),
+							  MakeUintegerAccessor(
+							  		&OpticalDevice::GetMemoryFootprint),
+							  MakeUintegerChecker<uint64_t>())
+				.AddAttribute("EcmpGroup",
+							  "Ports of a switch with the same non zero group "
+							  "are equal cost, reservations go to the least "
+							  "occupied one. 0 disables the selection.",
+							  UintegerValue(0),
+							  MakeUintegerAccessor(
+							  		&OpticalDevice::m_ecmp_group),
+							  MakeUintegerChecker<uint32_t>())
+				.AddAttribute("ControlScheduler",
+							  "The order queued control packets are sent in. "
+							  "Edf sends the earliest burst deadline first and "
+							  "drops reservations that would arrive too late.",
+							  EnumValue(OpticalDevice::FIFO),
+							  MakeEnumAccessor<ControlScheduler>(
+							  		&OpticalDevice::m_control_scheduler),
+							  MakeEnumChecker(OpticalDevice::FIFO, "Fifo",
+							  				  OpticalDevice::EDF, "Edf"))
+				.AddAttribute("FastForward",
+							  "Deliver a data burst to its endpoint with one "
+							  "event, walking the reserved path and checking "
+							  "collisions against the reservation tables.",
+							  BooleanValue(false),
+							  MakeBooleanAccessor(
+							  		&OpticalDevice::m_fast_forward),
+							  MakeBooleanChecker())
+				.AddAttribute("ChannelSelection",
+							  "How an endpoint picks the channel of a burst. "
+							  "FirstFit and LeastLoaded choose among the "
+							  "channels the first switch can still admit.",
+							  EnumValue(OpticalDevice::RANDOM_CHANNEL),
+							  MakeEnumAccessor<ChannelSelection>(
+							  		&OpticalDevice::m_channel_selection),
+							  MakeEnumChecker(OpticalDevice::RANDOM_CHANNEL,
+							  				  "Random",
+							  				  OpticalDevice::FIRST_FIT,
+							  				  "FirstFit",
+							  				  OpticalDevice::LEAST_LOADED,
+							  				  "LeastLoaded"))
+				.AddAttribute("Signalling",
+							  "How switches time reservations. Slotted uses "
+							  "the timeslots, Jet and Jit reserve each burst "
+							  "on its own, from one ReconfigureTime before "
+							  "it or from when the reservation is processed. "
+							  "Every device of a node must use the same.",
+							  EnumValue(OpticalDevice::SLOTTED),
+							  MakeEnumAccessor<Signalling>(
+							  		&OpticalDevice::m_signalling),
+							  MakeEnumChecker(OpticalDevice::SLOTTED, 
+							  				  "Slotted",
+							  				  OpticalDevice::JET, "Jet",
+							  				  OpticalDevice::JIT, "Jit"))
 				.AddTraceSource("DropTrace",
 								"Trace for when a packet is dropped",
 								MakeTraceSourceAccessor(
@@ -162,12 +244,21 @@ namespace ns3
 
 	OpticalDevice::OpticalDevice()
 		: m_msg_count(0),
+		  m_max_received(0),
+		  m_nack_count(0),
+		  m_ecmp_group(0),
+		  m_ecmp_moved_count(0),
+		  m_control_scheduler(FIFO),
+		  m_late_drop_count(0),
+		  m_fast_forward(false),
+		  m_channel_selection(RANDOM_CHANNEL),
+		  m_signalling(SLOTTED),
 		  m_channel(nullptr),
 		  m_is_endpoint(false),
 		  m_is_link_up(false),
 		  m_is_transmitting_control(false),
 		  m_is_transmitting_data(false),
-		  m_is_reconfiguring(false)
+		  m_control_edf_bytes(0)
 	{
 		NS_LOG_FUNCTION(this);
 	}
@@ -298,13 +389,24 @@ namespace ns3
 						const Address& dest,
 						uint16_t protocolNumber)
 	{
-		NS_LOG_FUNCTION(this << dest << protocolNumber);
+		OPTICAL_HOT_LOG_FUNCTION(this << dest << protocolNumber);
 		bool success = true;
-		bool control_full = m_control_queue->GetCurrentSize() >= 
-							m_control_queue->GetMaxSize();
+		bool control_full = IsControlFull();
 		//If endpoint seperate data and control
 		if (m_is_endpoint)
 		{
+			// No wavelength crosses the gratings on the path, so every
+			// reservation would be refused
+			Ipv4Header ipv4_header;
+			packet->PeekHeader(ipv4_header);
+			if (GetPath(ipv4_header).channels == 0)
+			{
+				if (!m_dropTrace.IsEmpty())
+				{
+					m_dropTrace(packet->Copy());
+				}
+				return false;
+			}
 			uint32_t id = ((uint32_t) m_dev_id << 16) | m_msg_count;
 			m_msg_count++;
 			success = InternalSend(packet, protocolNumber, id);
@@ -320,31 +422,39 @@ namespace ns3
 			UdpHeader udp_header;
 			read = packet->RemoveHeader(udp_header);
 			NS_ASSERT_MSG(read > 0, "Send message has no udp.");
-			uint32_t data_size = packet->GetSize();
-			uint8_t* buffer = new uint8_t[data_size];
-			NS_ASSERT_MSG(data_size == 26, "Data is wrong size.");
-			packet->CopyData(buffer, data_size);
+			NS_ASSERT_MSG(packet->GetSize() == 26, "Data is wrong size.");
+			uint8_t buffer[26];
+			packet->CopyData(buffer, sizeof(buffer));
 			uint8_t msg_type = buffer[0];
-			uint32_t id = BytesToUint32(buffer, 1);
-			uint64_t message_sent = BytesToUint64(buffer, 5);
-			uint64_t duration = BytesToUint64(buffer, 13);
+			uint32_t id = codec::LoadUint32(buffer, 1);
+			uint64_t message_sent = codec::LoadUint64(buffer, 5);
+			uint64_t duration = codec::LoadUint64(buffer, 13);
 			uint8_t channel = buffer[21];
-			int dev = BytesToUint32(buffer, 22);
-			Time propagation_delay = m_channel->GetDelay();
-			Time arrival = 
-				Time::FromInteger(message_sent, Time::NS) + propagation_delay;
+			int dev = codec::LoadUint32(buffer, 22);
 			Time tx_delay = Time::FromInteger(duration, Time::NS);
+			// Move the reservation to a less occupied equal-cost port, which
+			// is its own best choice so the forwarded send stays there
+			if (msg_type == 1 && m_ecmp_group > 0)
+			{
+				Ptr<OpticalDevice> egress = 
+					SelectEcmpEgress(message_sent, channel, tx_delay, dev);
+				if (egress != this)
+				{
+					m_ecmp_moved_count++;
+					return egress->Send(copy, dest, protocolNumber);
+				}
+			}
+			Time arrival = GetArrival(message_sent);
 			bool result = true;
 			if (msg_type == 1)
 			{
 				result = ScheduleMessage(arrival, GetRemote(), id, 
 										 channel, tx_delay, dev);
 			}
-			delete[] buffer;
 		
 			Ptr<TimeNode> node = DynamicCast<TimeNode>(m_node);
 			Time current = node->GetLocalTime();
-			uint32_t queue_size = m_control_queue->GetNPackets();
+			uint32_t queue_size = GetControlQueueDepth();
 			if (m_is_transmitting_control)
 			{
 				queue_size++;
@@ -356,6 +466,17 @@ namespace ns3
 			uint64_t ctrl_send_time = control_tx.GetNanoSeconds();
 			uint64_t data_send_time = (arrival + m_switch_propagation_delay)
 				.GetNanoSeconds();
+			// Releases this hop held nothing for walk on towards their
+			// source by IP, dev is the port the release came in on
+			if (msg_type == 4)
+			{
+				Ptr<OpticalDevice> egress = 
+					DynamicCast<OpticalDevice>(m_node->GetDevice(dev));
+				Time reserved = Time::FromInteger(message_sent, Time::NS) - 
+					egress->m_switch_propagation_delay;
+				data_send_time = (reserved - egress->m_channel->GetDelay())
+					.GetNanoSeconds();
+			}
 			
 			uint32_t cur_dev = GetIfIndex();
 			NS_ASSERT_MSG(dev >= 0, "Invalid device id.");
@@ -369,12 +490,12 @@ namespace ns3
 				{
 					//Update packet data
 					uint8_t buffer[26];
-					std::memcpy(&buffer[0], &msg_type, 1);
-					std::memcpy(&buffer[1], &id, 4);
-					std::memcpy(&buffer[5], &data_send_time, 8);
-					std::memcpy(&buffer[13], &duration, 8);
-					std::memcpy(&buffer[21], &channel, 1);
-					std::memcpy(&buffer[22], &cur_dev, 4);
+					buffer[0] = msg_type;
+					codec::StoreUint32(buffer, 1, id);
+					codec::StoreUint64(buffer, 5, data_send_time);
+					codec::StoreUint64(buffer, 13, duration);
+					buffer[21] = channel;
+					codec::StoreUint32(buffer, 22, cur_dev);
 					Ptr<Packet> new_packet = Create<Packet>(buffer, 26);
 					
 					new_packet->AddHeader(udp_header);
@@ -387,14 +508,10 @@ namespace ns3
 					tag.SetChannel(0);
 					tag.SetMsgId(id);
 					new_packet->AddPacketTag(tag);
+					AddressTag(new_packet, ipv4_header);
 					
-					m_control_queue->Enqueue(new_packet);
-
-					if (!m_is_transmitting_control)
-					{
-						Ptr<Packet> control = m_control_queue->Dequeue();
-						ControlTransmitStart(control);
-					}
+					ControlSend(new_packet, msg_type, 
+						Time::FromInteger(data_send_time, Time::NS));
 				}
 			}
 			else
@@ -402,13 +519,20 @@ namespace ns3
 				success = false;
 			}
 			
-			// If message not successful send NACK
+			// If message not successful release the hops before, the
+			// source takes the release as a NACK
 			if (!success && msg_type == 1)
 			{
+				m_nack_count++;
+				if (result)
+				{
+					m_clock->Cancel(arrival, dev, m_if_index, channel, id);
+				}
 				Ptr<NetDevice> base_dev = m_node->GetDevice(dev);
 				Ptr<OpticalDevice> from_dev = 
 					DynamicCast<OpticalDevice>(base_dev);
-				from_dev->SendCTRL(copy, protocolNumber, id, 2);
+				from_dev->SendReply(copy, protocolNumber, id, 4, message_sent,
+									duration, channel);
 			}
 		}
 		
@@ -419,7 +543,7 @@ namespace ns3
 	OpticalDevice::InternalSend(Ptr<Packet> packet, uint16_t protocol, 
 								uint32_t id)
 	{
-		NS_LOG_FUNCTION(this << packet << protocol << id);
+		OPTICAL_HOT_LOG_FUNCTION(this << packet << protocol << id);
 		Ptr<Packet> copy = packet->Copy();
 		Ptr<Packet> control;
 		Time message_send = SplitPacket(packet, control, protocol, id);
@@ -429,7 +553,7 @@ namespace ns3
 		uint8_t channel = tag.GetChannel();
 		AddOpticalHeader(copy, id, protocol, 0);
 		NS_ASSERT_MSG(channel > 0, "Should not be control channel");
-		bool success = ControlSend(control);
+		bool success = ControlSend(control, 1, message_send);
 		if (success)
 		{
 			Ptr<TimeNode> node = DynamicCast<TimeNode>(m_node);
@@ -456,29 +580,116 @@ namespace ns3
 	}
 
 	bool
-	OpticalDevice::ControlSend(Ptr<Packet> p)
+	OpticalDevice::ControlSend(Ptr<Packet> p, uint8_t msg_type, 
+							   Time data_time)
 	{
-		NS_LOG_FUNCTION(this << p);
-		bool control_full = m_control_queue->GetCurrentSize() >= 
-							m_control_queue->GetMaxSize();
+		OPTICAL_HOT_LOG_FUNCTION(this << p << msg_type << data_time);
+		bool control_full = IsControlFull();
 		if (!control_full)
 		{
-			m_control_queue->Enqueue(p);
+			if (m_control_scheduler == EDF)
+			{
+				// A reservation must be processed by the next hop before its
+				// burst leaves, AWK and NACK are due within a packet delay
+				Time local = DynamicCast<TimeNode>(m_node)->GetLocalTime();
+				Time deadline = local + m_packet_delay;
+				if (msg_type == 1)
+				{
+					deadline = data_time - m_packet_processing * 2 - 
+						m_control_bps.CalculateBytesTxTime(p->GetSize());
+				}
+				ControlItem item;
+				item.packet = p;
+				item.reservation = msg_type == 1;
+				m_control_edf.insert({deadline, item});
+				m_control_edf_bytes += p->GetSize();
+			}
+			else
+			{
+				m_control_queue->Enqueue(p);
+			}
 
 			if (!m_is_transmitting_control)
 			{
-				Ptr<Packet> control = m_control_queue->Dequeue();
-				ControlTransmitStart(control);
+				Ptr<Packet> control = DequeueControl();
+				if (control)
+				{
+					ControlTransmitStart(control);
+				}
 			}
 		}
 
 		return !control_full;
 	}
 
+	bool
+	OpticalDevice::IsControlFull() const
+	{
+		if (m_control_scheduler != EDF)
+		{
+			return m_control_queue->GetCurrentSize() >= 
+				m_control_queue->GetMaxSize();
+		}
+		QueueSize max = m_control_queue->GetMaxSize();
+		uint32_t used = (max.GetUnit() == QueueSizeUnit::PACKETS) ? 
+			m_control_edf.size() : m_control_edf_bytes;
+		return used >= max.GetValue();
+	}
+
+	Ptr<Packet>
+	OpticalDevice::DequeueControl()
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this);
+		if (m_control_scheduler != EDF)
+		{
+			return m_control_queue->Dequeue();
+		}
+		Time local = DynamicCast<TimeNode>(m_node)->GetLocalTime();
+		while (!m_control_edf.empty())
+		{
+			auto iter = m_control_edf.begin();
+			Time deadline = iter->first;
+			ControlItem item = iter->second;
+			m_control_edf.erase(iter);
+			m_control_edf_bytes -= item.packet->GetSize();
+			if (!item.reservation || deadline >= local)
+			{
+				return item.packet;
+			}
+			// Too late for its burst, endpoints reschedule the burst now
+			m_late_drop_count++;
+			if (!m_dropTrace.IsEmpty())
+			{
+				m_dropTrace(item.packet->Copy());
+			}
+			if (m_is_endpoint)
+			{
+				OpticalTag tag;
+				bool found_tag = item.packet->PeekPacketTag(tag);
+				NS_ASSERT_MSG(found_tag, "Control packet has no optical tag.");
+				Simulator::ScheduleNow(&OpticalDevice::CheckSent, this,
+									   tag.GetMsgId());
+				continue;
+			}
+			// Switches already hold the burst, release it upstream
+			Ptr<Packet> copy = item.packet->Copy();
+			OpticalHeader header;
+			copy->RemoveHeader(header);
+			Ipv4Header ipv4_header;
+			uint32_t read = copy->RemoveHeader(ipv4_header);
+			NS_ASSERT_MSG(read > 0, "Queued message has no ipv4.");
+			Ipv4Address source = ipv4_header.GetSource();
+			ipv4_header.SetSource(ipv4_header.GetDestination());
+			ipv4_header.SetDestination(source);
+			ReturnRelease(copy, ipv4_header, header.GetProtocol());
+		}
+		return nullptr;
+	}
+
 	void
 	OpticalDevice::CheckSent(uint32_t id)
 	{	
-		NS_LOG_FUNCTION(this << id);
+		OPTICAL_HOT_LOG_FUNCTION(this << id);
 		auto iter = m_sent_table.find(id);
 		if (iter != m_sent_table.end())
 		{
@@ -495,41 +706,11 @@ namespace ns3
 		}
 	}
 
-	uint64_t
-	OpticalDevice::BytesToUint64(uint8_t* buffer, int offset)
-	{
-		NS_LOG_FUNCTION(this << buffer << offset);
-		uint64_t low = static_cast<uint64_t>(BytesToUint32(buffer, offset));
-		uint64_t high = static_cast<uint64_t>(BytesToUint32(buffer, offset + 4));
-		uint64_t value = high << 32 | low;
-		return value;
-	}
-
-	uint32_t
-	OpticalDevice::BytesToUint32(uint8_t* buffer, int offset)
-	{
-		NS_LOG_FUNCTION(this << buffer << offset);
-		uint32_t low = static_cast<uint32_t>(BytesToUint16(buffer, offset));
-		uint32_t high = static_cast<uint32_t>(BytesToUint16(buffer, offset + 2));
-		uint32_t value = high << 16 | low;
-		return value;
-	}
-
-	uint16_t
-	OpticalDevice::BytesToUint16(uint8_t* buffer, int offset)
-	{
-		NS_LOG_FUNCTION(this << buffer << offset);
-		uint16_t low = static_cast<uint16_t>(buffer[offset]);
-		uint16_t high = static_cast<uint16_t>(buffer[offset + 1]);
-		uint16_t value = high << 8 | low;
-		return value;
-	}
-
 	Time
 	OpticalDevice::SplitPacket(Ptr<Packet> data, Ptr<Packet>& control, 
 							   uint16_t protocol, uint32_t id)
 	{
-		NS_LOG_FUNCTION(this << data << control << protocol << id);
+		OPTICAL_HOT_LOG_FUNCTION(this << data << control << protocol << id);
 
 		Ptr<Packet> copy = data->Copy();
 		OpticalHeader optical_header;
@@ -540,8 +721,6 @@ namespace ns3
 		UdpHeader udp_header;
 		read = copy->RemoveHeader(udp_header);
 		NS_ASSERT_MSG(read > 0, "Split copy no udp.");
-		uint8_t channel = GetRandomChannel();
-		
 		Ptr<TimeNode> node = DynamicCast<TimeNode>(m_node);
 		uint64_t current = node->GetLocalTime().GetNanoSeconds();
 		AddOpticalHeader(data, id, protocol, current);
@@ -551,20 +730,23 @@ namespace ns3
 								  udp_header.GetSerializedSize();
 		Time tx_ctrl = m_control_bps.CalculateBytesTxTime(ctrl_size);
 		uint64_t duration = tx_data.GetNanoSeconds();	
-		uint64_t message_send = GetPacketTransmitTime(tx_ctrl, tx_data)
+		PathItem path = GetPath(ipv4_header);
+		uint64_t message_send = 
+			GetPacketTransmitTime(tx_ctrl, tx_data, path.switches)
 			.GetNanoSeconds();
+		uint8_t channel = SelectChannel(message_send, tx_data, ipv4_header);
 		uint8_t msg_type = 1;
 		
 		int dev = GetIfIndex();
 		NS_ASSERT_MSG(dev >= 0, "Invalid device id.");
 
 		uint8_t buffer[26];
-		std::memcpy(&buffer[0], &msg_type, 1); 
-		std::memcpy(&buffer[1], &id, 4);
-		std::memcpy(&buffer[5], &message_send, 8);
-		std::memcpy(&buffer[13], &duration, 8);
-		std::memcpy(&buffer[21], &channel, 1);
-		std::memcpy(&buffer[22], &dev, 4);
+		buffer[0] = msg_type;
+		codec::StoreUint32(buffer, 1, id);
+		codec::StoreUint64(buffer, 5, message_send);
+		codec::StoreUint64(buffer, 13, duration);
+		buffer[21] = channel;
+		codec::StoreUint32(buffer, 22, dev);
 		control = Create<Packet>(buffer, 26);
 		control->AddHeader(udp_header);
 		control->AddHeader(ipv4_header);
@@ -583,14 +765,91 @@ namespace ns3
 			"Packet should not be dropped by default.");
 		control->AddPacketTag(tag2);
 		CopyTags(copy, control);
+		AddressTag(data, ipv4_header);
+		AddressTag(control, ipv4_header);
 
 		return Time::FromInteger(message_send, Time::NS);
 	}
 
+	Mac48Address
+	OpticalDevice::GetNextHop(const Ipv4Header& header) const
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this);
+		Ptr<Ipv4> ipv4 = m_node->GetObject<Ipv4>();
+		if (!ipv4 || !ipv4->GetRoutingProtocol())
+		{
+			return Mac48Address::GetBroadcast();
+		}
+		Socket::SocketErrno error;
+		Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol()->RouteOutput(
+			nullptr, header, nullptr, error);
+		if (!route)
+		{
+			return Mac48Address::GetBroadcast();
+		}
+		Ipv4Address next = route->GetGateway();
+		if (next == Ipv4Address::GetAny())
+		{
+			next = header.GetDestination();
+		}
+		for (std::size_t i = 0; i < m_channel->GetNDevices(); i++)
+		{
+			Ptr<NetDevice> dev = m_channel->GetDevice(i);
+			Ptr<Ipv4> other = dev->GetNode()->GetObject<Ipv4>();
+			if (dev != this && other && 
+				other->GetInterfaceForAddress(next) >= 0)
+			{
+				return Mac48Address::ConvertFrom(dev->GetAddress());
+			}
+		}
+		return Mac48Address::GetBroadcast();
+	}
+
+	void
+	OpticalDevice::AddressTag(Ptr<Packet> p, const Ipv4Header& header) const
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << p);
+		// Point to point links have a single receiver already
+		if (m_channel->GetNDevices() == 2)
+		{
+			return;
+		}
+		OpticalTag tag;
+		bool found_tag = p->RemovePacketTag(tag);
+		NS_ASSERT_MSG(found_tag, "Packet should have optical tag.");
+		tag.SetDestination(GetNextHop(header));
+		p->AddPacketTag(tag);
+	}
+
+	void
+	OpticalDevice::AddressData(Ptr<Packet> p) const
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << p);
+		if (m_channel->GetNDevices() == 2)
+		{
+			// Drop a destination set on an earlier shared hop
+			OpticalTag tag;
+			if (p->PeekPacketTag(tag) && !tag.GetDestination().IsBroadcast())
+			{
+				p->RemovePacketTag(tag);
+				tag.SetDestination(Mac48Address::GetBroadcast());
+				p->AddPacketTag(tag);
+			}
+			return;
+		}
+		Ptr<Packet> copy = p->Copy();
+		OpticalHeader optical_header;
+		copy->RemoveHeader(optical_header);
+		Ipv4Header ipv4_header;
+		uint32_t read = copy->PeekHeader(ipv4_header);
+		NS_ASSERT_MSG(read > 0, "Data burst has no ipv4.");
+		AddressTag(p, ipv4_header);
+	}
+
 	void
 	OpticalDevice::CopyTags(Ptr<Packet> original, Ptr<Packet> copy)
 	{
-		NS_LOG_FUNCTION(this);
+		OPTICAL_HOT_LOG_FUNCTION(this);
 		Ptr<Packet> spare_parts = original->Copy();
 		
 		SocketSetDontFragmentTag ssdft;
@@ -616,49 +875,239 @@ namespace ns3
 	}
 
 	Time
-	OpticalDevice::GetPacketTransmitTime(Time& tx_ctrl, Time& tx_data)
+	OpticalDevice::GetPacketTransmitTime(Time& tx_ctrl, Time& tx_data,
+										 uint32_t switches)
 	{
-		NS_LOG_FUNCTION(this);
+		OPTICAL_HOT_LOG_FUNCTION(this);
 		Ptr<TimeNode> node = DynamicCast<TimeNode>(m_node);
 		Time current = node->GetLocalTime();
-		uint32_t queue_size = m_control_queue->GetNPackets();
+		uint32_t queue_size = GetControlQueueDepth();
 		if (m_is_transmitting_control)
 		{
 			queue_size++;
 		}
 		Time control_tx = m_packet_processing + 
 			(tx_ctrl + m_packet_processing + m_control_frame_gap) * queue_size;
+		// Without slots the burst only waits for the offset and the port.
+		// The offset covers the reservation falling behind at every switch
+		// and the setup of the last one, PacketDelay if the path is unknown
+		if (m_signalling != SLOTTED)
+		{
+			Time offset = (switches == 0) ? m_packet_delay : 
+				(m_packet_processing + tx_ctrl + m_control_frame_gap) * 
+				switches + m_reconfigure_time;
+			Time send_time = std::max(current + control_tx + offset,
+									  m_next_transmit);
+			m_next_transmit = send_time + tx_data + m_data_frame_gap + 
+				Time::FromInteger(1, Time::NS);
+			return send_time;
+		}
+		int64_t first = m_clock->GetCurrentSlot(current);
+		if (m_next_transmit < m_clock->GetSlotStart(first))
+		{
+			m_next_transmit = m_clock->GetSlotStart(first);
+		}
 		Time estimate_send = current + control_tx + m_packet_delay;
 		Time send_time = (estimate_send >= m_next_transmit) ? estimate_send : 
 			m_next_transmit;
 		Time total_time = send_time + tx_data + m_total_propagation_delay;
-		for (const auto& pair : m_schedule_table)
+		// Bursts ending in a reconfiguration window wait for its slot
+		int64_t slot = m_clock->GetCurrentSlot(total_time);
+		if (m_clock->IsReconfiguring(total_time) && 
+			slot < first + m_schedule_size)
 		{
-			const Time timeslot = pair.first;
-			if ((total_time >= timeslot - m_reconfigure_time) &&
-				(total_time < timeslot))
-			{
-				send_time = timeslot;
-				break;
-			}
+			send_time = m_clock->GetSlotStart(slot);
 		}
 		m_next_transmit = send_time + tx_data + m_data_frame_gap + 
 			Time::FromInteger(1, Time::NS);
 		return send_time;
 	}
 
+	static std::mt19937&
+	GetChannelRng()
+	{
+		static std::mt19937 rng(std::time(nullptr));
+		return rng;
+	}
+
+	// Bits 1 to channels, the data channels a mask can hold
+	static uint64_t
+	GetChannelMask(uint8_t channels)
+	{
+		return (channels >= 63) ? ~static_cast<uint64_t>(1) : 
+			(static_cast<uint64_t>(1) << (channels + 1)) - 2;
+	}
+
 	uint8_t
 	OpticalDevice::GetRandomChannel()
 	{
-		NS_LOG_FUNCTION(this);
-		static std::mt19937 rng(std::time(nullptr));
+		OPTICAL_HOT_LOG_FUNCTION(this);
 		uint8_t num_channels = m_channel->GetNChannels();
 		std::uniform_int_distribution<uint8_t> dist(1, num_channels);
-		uint8_t channel = dist(rng);
+		uint8_t channel = dist(GetChannelRng());
 		NS_ASSERT_MSG(channel > 0 && channel <= num_channels,
 					  "Random channel is outside bounds.");
 		return channel;
 	}
+
+	uint8_t
+	OpticalDevice::GetRandomChannel(uint64_t mask)
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << mask);
+		uint64_t all = GetChannelMask(m_channel->GetNChannels());
+		mask &= all;
+		if (mask == all)
+		{
+			return GetRandomChannel();
+		}
+		uint32_t count = 0;
+		for (uint64_t bits = mask; bits != 0; bits &= bits - 1)
+		{
+			count++;
+		}
+		NS_ASSERT_MSG(count > 0, "No channel to choose from.");
+		std::uniform_int_distribution<uint32_t> dist(0, count - 1);
+		uint32_t pick = dist(GetChannelRng());
+		for (uint8_t c = 1; c < 64; c++)
+		{
+			if ((mask >> c & 1) && pick-- == 0)
+			{
+				return c;
+			}
+		}
+		return 0;
+	}
+
+	PathItem
+	OpticalDevice::GetPath(const Ipv4Header& header)
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this);
+		auto cached = m_paths.find(header.GetDestination());
+		if (cached != m_paths.end())
+		{
+			return cached->second;
+		}
+		uint8_t num_channels = m_channel->GetNChannels();
+		PathItem path;
+		path.channels = GetChannelMask(num_channels);
+		path.switches = 0;
+		Ptr<OpticalDevice> hop = this;
+		for (uint32_t i = 0; i < NodeList::GetNNodes(); i++)
+		{
+			Ptr<OpticalChannel> link = hop->m_channel;
+			if (link->GetNDevices() != 2)
+			{
+				break;
+			}
+			Ptr<OpticalDevice> ingress = DynamicCast<OpticalDevice>(
+				link->GetDevice(1 - link->GetDeviceIndex(hop)));
+			if (ingress->m_is_endpoint)
+			{
+				m_paths[header.GetDestination()] = path;
+				return path;
+			}
+			// Routes not populated yet, try again on the next message
+			Ptr<OpticalDevice> egress = ingress->GetRouteEgress(header);
+			if (!egress)
+			{
+				break;
+			}
+			path.switches++;
+			// A grating only reaches the routed port on some wavelengths
+			if (ingress->m_awgr)
+			{
+				uint64_t valid = 0;
+				for (uint8_t c = 1; c <= num_channels && c < 64; c++)
+				{
+					if (ingress->m_awgr->GetRoute(ingress->m_if_index, c) == 
+						static_cast<int>(egress->m_if_index))
+					{
+						valid |= static_cast<uint64_t>(1) << c;
+					}
+				}
+				path.channels &= valid;
+			}
+			hop = egress;
+		}
+		path.switches = 0;
+		return path;
+	}
+
+	Ptr<OpticalDevice>
+	OpticalDevice::GetRouteEgress(const Ipv4Header& header) const
+	{
+		Ptr<Ipv4> ipv4 = m_node->GetObject<Ipv4>();
+		if (!ipv4 || !ipv4->GetRoutingProtocol())
+		{
+			return nullptr;
+		}
+		Socket::SocketErrno error;
+		Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol()->RouteOutput(
+			nullptr, header, nullptr, error);
+		if (!route)
+		{
+			return nullptr;
+		}
+		return DynamicCast<OpticalDevice>(route->GetOutputDevice());
+	}
+	
+	uint8_t
+	OpticalDevice::SelectChannel(uint64_t message_sent, Time tx_data, 
+								 const Ipv4Header& header)
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << message_sent << tx_data);
+		uint64_t path = GetPath(header).channels;
+		if (m_channel_selection == RANDOM_CHANNEL || 
+			m_channel->GetNDevices() != 2)
+		{
+			return GetRandomChannel(path);
+		}
+		Ptr<OpticalDevice> ingress = DynamicCast<OpticalDevice>(
+			m_channel->GetDevice(1 - m_channel->GetDeviceIndex(this)));
+		uint8_t num_channels = m_channel->GetNChannels();
+		// A direct link to another endpoint has every channel to itself
+		if (ingress->m_is_endpoint)
+		{
+			return 1;
+		}
+		// The egress port the switch will route the reservation to
+		Ptr<OpticalDevice> egress = ingress->GetRouteEgress(header);
+		// Free lanes come back as a 64-bit mask, channel 64 would not fit
+		if (!egress || egress->m_channel->GetNChannels() >= 64)
+		{
+			return GetRandomChannel(path);
+		}
+		// The arrival the switch will admit the burst at
+		Time arrival = egress->GetArrival(message_sent);
+		uint64_t free = egress->GetFreeChannels(arrival, egress->GetRemote(), 
+			tx_data, ingress->m_if_index) & path;
+		// Nothing fits, the reservation is refused whichever is sent
+		if (free == 0)
+		{
+			return GetRandomChannel(path);
+		}
+		uint8_t best = 0;
+		uint32_t best_load = std::numeric_limits<uint32_t>::max();
+		for (uint8_t c = 1; c <= num_channels && c < 64; c++)
+		{
+			if (!(free >> c & 1))
+			{
+				continue;
+			}
+			if (m_channel_selection == FIRST_FIT)
+			{
+				return c;
+			}
+			uint32_t load = egress->GetSlotOccupancy(arrival, c);
+			if (load < best_load)
+			{
+				best = c;
+				best_load = load;
+			}
+		}
+		NS_ASSERT_MSG(best > 0, "Free channel is outside bounds.");
+		return best;
+	}
 	
 	bool
 	OpticalDevice::SendFrom(Ptr<Packet> packet,
@@ -789,8 +1238,12 @@ namespace ns3
 	void
 	OpticalDevice::Receive(Ptr<Packet> p)
 	{
-		NS_LOG_FUNCTION(this << p);
-		m_rxTrace(p->Copy());
+		OPTICAL_HOT_LOG_FUNCTION(this << p);
+		OpticalProfiler::Scope profile(OpticalProfiler::RECEIVE, m_is_endpoint);
+		if (!m_rxTrace.IsEmpty())
+		{
+			m_rxTrace(p->Copy());
+		}
 		OpticalTag tag;
 		OpticalHeader header;
 		bool found_tag = p->PeekPacketTag(tag);
@@ -812,10 +1265,9 @@ namespace ns3
 				UdpHeader udp_header;
 				read = p->RemoveHeader(udp_header);
 				NS_ASSERT_MSG(read > 0, "Send message has no udp.");
-				uint32_t data_size = p->GetSize();
-				uint8_t* buffer = new uint8_t[data_size];
-				NS_ASSERT_MSG(data_size == 26, "Data is wrong size.");
-				p->CopyData(buffer, data_size);
+				NS_ASSERT_MSG(p->GetSize() == 26, "Data is wrong size.");
+				uint8_t buffer[26];
+				p->CopyData(buffer, sizeof(buffer));
 				
 				uint32_t id = header.GetMsgId();
 				uint8_t msg_type = buffer[0];
@@ -829,7 +1281,7 @@ namespace ns3
 										protocol,
 										id);
 				}
-				else if (msg_type == 2 || msg_type == 3)
+				else if (msg_type == 2 || msg_type == 3 || msg_type == 4)
 				{
 					OpticalHeader copy_header;
 					ScheduleItem sched_item;
@@ -858,8 +1310,13 @@ namespace ns3
 						}
 					}
 					
-					// NACK
-					if (found && msg_type == 2)
+					// NACK or release
+					bool refused = msg_type == 2 || msg_type == 4;
+					if (refused)
+					{
+						m_nack_count++;
+					}
+					if (found && refused)
 					{
 						Simulator::Cancel(sched_item.schedule_event);
 						Simulator::Cancel(sched_item.check_event);
@@ -897,6 +1354,11 @@ namespace ns3
 				{
 					m_expected.erase(it_e);
 					m_received.push_back(id);
+					if (m_max_received > 0 && 
+						m_received.size() > m_max_received)
+					{
+						m_received.pop_front();
+					}
 					if (!m_promiscCallback.IsNull())
 					{
 						m_promiscCallback(this,
@@ -940,21 +1402,26 @@ namespace ns3
 				UdpHeader udp_header;
 				read = p->RemoveHeader(udp_header);
 				NS_ASSERT_MSG(read > 0, "Send message has no udp.");
-				uint32_t data_size = p->GetSize();
-				uint8_t* buffer = new uint8_t[data_size];
-				NS_ASSERT_MSG(data_size == 26, "Data is wrong size.");
-				p->CopyData(buffer, data_size);
+				NS_ASSERT_MSG(p->GetSize() == 26, "Data is wrong size.");
+				uint8_t buffer[26];
+				p->CopyData(buffer, sizeof(buffer));
 				uint16_t protocol = header.GetProtocol();
 				
 				int dev = GetIfIndex();
 				NS_ASSERT_MSG(dev >= 0, "Invalid device id.");
-				std::memcpy(&buffer[22], &dev, 4);
+				codec::StoreUint32(buffer, 22, dev);
 				
 				Ptr<Packet> new_packet = Create<Packet>(buffer, 26);
 				new_packet->AddHeader(udp_header);
-				new_packet->AddHeader(ipv4_header);
 				CopyTags(p, new_packet);
-				delete[] buffer;
+				// A release retraces the hops that reserved its burst, IP
+				// routing back to the source may take another path
+				if (buffer[0] == 4 && 
+					ReturnRelease(new_packet, ipv4_header, protocol))
+				{
+					return;
+				}
+				new_packet->AddHeader(ipv4_header);
 				
 				if (!m_promiscCallback.IsNull())
 				{
@@ -969,10 +1436,7 @@ namespace ns3
 			}
 			else
 			{
-				NS_ASSERT_MSG(!m_schedule_table.empty(),
-							  "Schedule should not be empty.");
-				std::vector<int> entry = m_schedule_table.begin()->second;
-				int dev_idx = entry[channel];
+				int dev_idx = GetOpticalRoute(channel);
 				if (dev_idx >= 0)
 				{
 					Ptr<NetDevice> ndev = m_node->GetDevice(dev_idx);
@@ -981,7 +1445,10 @@ namespace ns3
 				}
 				else
 				{
-					m_dropTrace(p->Copy());
+					if (!m_dropTrace.IsEmpty())
+					{
+						m_dropTrace(p->Copy());
+					}
 				}
 			}
 		}
@@ -991,7 +1458,7 @@ namespace ns3
 	OpticalDevice::UpdateReceived(Ptr<Packet> copy, uint16_t protocol,
 								  uint32_t id)
 	{
-		NS_LOG_FUNCTION(this << copy << protocol << id);
+		OPTICAL_HOT_LOG_FUNCTION(this << copy << protocol << id);
 		auto it_e = std::find(m_expected.begin(),
 			m_expected.end(), id);
 		auto it_r = std::find(m_received.begin(), 
@@ -1012,7 +1479,7 @@ namespace ns3
 	void
 	OpticalDevice::FinalCallback(Ptr<Packet> packet, uint16_t protocol)
 	{
-		NS_LOG_FUNCTION(this << packet << protocol);
+		OPTICAL_HOT_LOG_FUNCTION(this << packet << protocol);
 		m_rxCallback(this, packet, protocol, GetRemote());
 	}
 
@@ -1020,7 +1487,16 @@ namespace ns3
 	OpticalDevice::SendCTRL(Ptr<Packet> copy, uint16_t protocol, uint32_t id,
 							uint8_t msg_type)
 	{
-		NS_LOG_FUNCTION(this);
+		OPTICAL_HOT_LOG_FUNCTION(this);
+		SendReply(copy, protocol, id, msg_type, 0, 0, 1);
+	}
+
+	void
+	OpticalDevice::SendReply(Ptr<Packet> copy, uint16_t protocol, uint32_t id,
+							 uint8_t msg_type, uint64_t message_send,
+							 uint64_t duration, uint8_t channel)
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << id << msg_type);
 		Ipv4Header ipv4_header;
 		uint32_t read = copy->RemoveHeader(ipv4_header);
 		NS_ASSERT_MSG(read > 0, "Sent message has no ipv4.");
@@ -1030,17 +1506,14 @@ namespace ns3
 
 		int dev = GetIfIndex();
 		NS_ASSERT_MSG(dev >= 0, "Invalid device id.");
-		uint64_t message_send = 0;
-		uint64_t duration = 0;
-		uint64_t channel = 1;
 
 		uint8_t buffer[26];
-		std::memcpy(&buffer[0], &msg_type, 1); 
-		std::memcpy(&buffer[1], &id, 4);
-		std::memcpy(&buffer[5], &message_send, 8);
-		std::memcpy(&buffer[13], &duration, 8);
-		std::memcpy(&buffer[21], &channel, 1);
-		std::memcpy(&buffer[22], &dev, 4);
+		buffer[0] = msg_type;
+		codec::StoreUint32(buffer, 1, id);
+		codec::StoreUint64(buffer, 5, message_send);
+		codec::StoreUint64(buffer, 13, duration);
+		buffer[21] = channel;
+		codec::StoreUint32(buffer, 22, dev);
 		Ptr<Packet> ctrl = Create<Packet>(buffer, 26);
 		
 		Ipv4Address p_src = ipv4_header.GetSource();
@@ -1061,8 +1534,79 @@ namespace ns3
 		tag.SetMsgId(id);
 		ctrl->AddPacketTag(tag);
 		CopyTags(copy, ctrl);
+		AddressTag(ctrl, ipv4_header);
+
+		ControlSend(ctrl, msg_type, Seconds(0));
+	}
+
+	bool
+	OpticalDevice::ReturnRelease(Ptr<Packet> packet, 
+								 const Ipv4Header& ipv4_header,
+								 uint16_t protocol)
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << packet << protocol);
+		Ptr<Packet> copy = packet->Copy();
+		UdpHeader udp_header;
+		uint32_t read = copy->RemoveHeader(udp_header);
+		NS_ASSERT_MSG(read > 0, "Release has no udp.");
+		NS_ASSERT_MSG(copy->GetSize() == 26, "Data is wrong size.");
+		uint8_t buffer[26];
+		copy->CopyData(buffer, sizeof(buffer));
+		uint32_t id = codec::LoadUint32(buffer, 1);
+		uint8_t channel = buffer[21];
+		// The timestamp is when the burst would have left this port
+		Time reserved = Time::FromInteger(codec::LoadUint64(buffer, 5), 
+			Time::NS) - m_switch_propagation_delay;
+		int ingress = GetReservedIngress(reserved, channel, id);
+		if (ingress < 0)
+		{
+			return false;
+		}
+		if (!m_awgr)
+		{
+			m_clock->Cancel(reserved, ingress, m_if_index, channel, id);
+		}
+		Ptr<OpticalDevice> from_dev = 
+			DynamicCast<OpticalDevice>(m_node->GetDevice(ingress));
+		buffer[0] = 4;
+		codec::StoreUint64(buffer, 5, 
+			(reserved - m_channel->GetDelay()).GetNanoSeconds());
+		codec::StoreUint32(buffer, 22, ingress);
+		Ptr<Packet> release = Create<Packet>(buffer, 26);
+		release->AddHeader(udp_header);
+		release->AddHeader(ipv4_header);
+		Ptr<TimeNode> node = DynamicCast<TimeNode>(m_node);
+		AddOpticalHeader(release, id, protocol, 
+						 node->GetLocalTime().GetNanoSeconds());
+		OpticalTag tag;
+		tag.SetChannel(0);
+		tag.SetMsgId(id);
+		release->AddPacketTag(tag);
+		CopyTags(packet, release);
+		from_dev->AddressTag(release, ipv4_header);
+		from_dev->ControlSend(release, 4, Seconds(0));
+		return true;
+	}
 
-		ControlSend(ctrl);
+	int
+	OpticalDevice::GetReservedIngress(Time arrival, uint8_t channel, 
+									  uint32_t id) const
+	{
+		// An AWGR holds nothing, its one port reaching this on the channel
+		// is the ingress
+		if (m_awgr)
+		{
+			for (uint32_t i = 0; i < m_node->GetNDevices(); i++)
+			{
+				if (m_awgr->GetRoute(i, channel) == 
+					static_cast<int>(m_if_index))
+				{
+					return i;
+				}
+			}
+			return -1;
+		}
+		return m_clock->GetIngress(arrival, m_if_index, channel, id);
 	}
 
 	void
@@ -1084,12 +1628,20 @@ namespace ns3
 		NS_LOG_FUNCTION(this);
 		m_node = nullptr;
 		m_channel = nullptr;
+		m_clock = nullptr;
+		m_awgr = nullptr;
+		m_control_edf.clear();
 		NetDevice::DoDispose();
 	}
 
 	Address
 	OpticalDevice::GetRemote() const
 	{
+		// A shared medium has no single remote, the port reaches every device
+		if (m_channel->GetNDevices() != 2)
+		{
+			return GetBroadcast();
+		}
 		Ptr<NetDevice> dev = (m_channel->GetDevice(0) == this) ? 
 				m_channel->GetDevice(1) : m_channel->GetDevice(0);
 		return dev->GetAddress();
@@ -1102,7 +1654,7 @@ namespace ns3
 									uint64_t message_timestamp,
 									uint8_t channel)
 	{
-		NS_LOG_FUNCTION(this << id << send_timestamp << message_timestamp <<
+		OPTICAL_HOT_LOG_FUNCTION(this << id << send_timestamp << message_timestamp <<
 						channel);
 		OpticalControlHeader header;
 		header.SetMsgId(id);
@@ -1121,7 +1673,7 @@ namespace ns3
 								 uint32_t id,
 								 uint64_t send_timestamp)
 	{
-		NS_LOG_FUNCTION(this << p << id << send_timestamp);
+		OPTICAL_HOT_LOG_FUNCTION(this << p << id << send_timestamp);
 		OpticalDataHeader header;
 		header.SetMsgId(id);
 		header.SetSendTimestamp(send_timestamp);
@@ -1135,7 +1687,7 @@ namespace ns3
 									uint16_t protocol,
 									uint64_t send_timestamp)
 	{
-		NS_LOG_FUNCTION(this << p << id << protocol << send_timestamp);
+		OPTICAL_HOT_LOG_FUNCTION(this << p << id << protocol << send_timestamp);
 		OpticalHeader header;
 		header.SetProtocol(protocol);
 		header.SetTimestamp(send_timestamp);
@@ -1146,13 +1698,16 @@ namespace ns3
 	void
 	OpticalDevice::ControlTransmitStart(Ptr<Packet> p)
 	{
-		NS_LOG_FUNCTION(this << p);
+		OPTICAL_HOT_LOG_FUNCTION(this << p);
 		NS_ASSERT_MSG(!m_is_transmitting_control, "Should not be transmitting");
 		m_is_transmitting_control = true;
 		Time tx_time = m_control_bps.CalculateBytesTxTime(p->GetSize());
 		Time total_time = tx_time + m_packet_processing + 
 			m_control_frame_gap;
-		m_txTrace(p->Copy());
+		if (!m_txTrace.IsEmpty())
+		{
+			m_txTrace(p->Copy());
+		}
 		Simulator::Schedule(m_packet_processing,
 							&OpticalChannel::TransmitStart,
 							m_channel,
@@ -1167,10 +1722,10 @@ namespace ns3
 	void
 	OpticalDevice::ControlTransmitComplete()
 	{
-		NS_LOG_FUNCTION(this);
+		OPTICAL_HOT_LOG_FUNCTION(this);
 		NS_ASSERT_MSG(m_is_transmitting_control, "Should be transmitting");
 		m_is_transmitting_control = false;
-		Ptr<Packet> p = m_control_queue->Dequeue();
+		Ptr<Packet> p = DequeueControl();
 		if (p)
 		{
 			ControlTransmitStart(p);
@@ -1181,7 +1736,7 @@ namespace ns3
 	OpticalDevice::DataTransmitStart(Ptr<Packet> p)
 	{
 
-		NS_LOG_FUNCTION(this << p);
+		OPTICAL_HOT_LOG_FUNCTION(this << p);
 		OpticalTag tag;
 		bool found_tag = p->PeekPacketTag(tag);
 		NS_ASSERT_MSG(found_tag, "Packet did not have optical tag.");
@@ -1194,8 +1749,18 @@ namespace ns3
 			Time total_time = tx_time + m_data_frame_gap;
 			Ptr<TimeNode> node = DynamicCast<TimeNode>(m_node);
 			
-			m_txTrace(p->Copy());
-			m_channel->PassThrough(p, this, tx_time);
+			if (!m_txTrace.IsEmpty())
+			{
+				m_txTrace(p->Copy());
+			}
+			if (m_fast_forward)
+			{
+				FastForward(p, tx_time);
+			}
+			else
+			{
+				m_channel->PassThrough(p, this, tx_time);
+			}
 			Simulator::Schedule(total_time, 
 								&OpticalDevice::DataTransmitComplete,
 								this);
@@ -1205,16 +1770,91 @@ namespace ns3
 	void
 	OpticalDevice::DataTransmitComplete()
 	{
-		NS_LOG_FUNCTION(this);
+		OPTICAL_HOT_LOG_FUNCTION(this);
 		NS_ASSERT_MSG(m_is_transmitting_data, "Should be transmitting");
 		m_is_transmitting_data = false;
 	}
 
+	void
+	OpticalDevice::FastForward(Ptr<Packet> p, Time tx_time)
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << p << tx_time);
+		OpticalProfiler::Scope profile(OpticalProfiler::FAST_FORWARD,
+									   m_is_endpoint);
+		OpticalTag tag;
+		bool found_tag = p->PeekPacketTag(tag);
+		NS_ASSERT_MSG(found_tag, "Packet should have optical tag.");
+		uint8_t channel = tag.GetChannel();
+		uint32_t id = tag.GetMsgId();
+		Time delay;
+		Ptr<OpticalDevice> hop = this;
+		for (uint32_t i = 0; i < NodeList::GetNNodes(); i++)
+		{
+			Ptr<OpticalChannel> link = hop->m_channel;
+			// Shared channels keep the event path from this hop on
+			if (link->GetNDevices() != 2)
+			{
+				hop->AddressData(p);
+				Simulator::Schedule(delay, &OpticalChannel::PassThrough,
+									link, p, hop, tx_time);
+				return;
+			}
+			Ptr<OpticalDevice> next = DynamicCast<OpticalDevice>(
+				link->GetDevice(1 - link->GetDeviceIndex(hop)));
+			delay += link->GetDelay();
+			if (next->m_is_endpoint)
+			{
+				Simulator::ScheduleWithContext(next->m_node->GetId(),
+											   delay + tx_time,
+											   &OpticalDevice::Receive,
+											   next,
+											   p);
+				return;
+			}
+			Time local = 
+				DynamicCast<TimeNode>(next->m_node)->GetLocalTimeAfter(delay);
+			int route = next->GetOpticalRoute(channel, local);
+			if (route < 0 || 
+				(!next->m_awgr && next->m_signalling == SLOTTED && 
+				 next->m_clock->IsReconfiguring(local)))
+			{
+				if (!next->m_dropTrace.IsEmpty())
+				{
+					next->m_dropTrace(p->Copy());
+				}
+				return;
+			}
+			Ptr<OpticalDevice> egress = 
+				DynamicCast<OpticalDevice>(next->m_node->GetDevice(route));
+			if (!next->m_awgr &&
+				(next->m_clock->Conflicts(local, local + tx_time, 
+										  next->m_if_index, channel, id) ||
+				 next->m_clock->Conflicts(local, local + tx_time, 
+										  egress->m_if_index, channel, id)))
+			{
+				egress->m_collisionTrace(next, p);
+				p->RemovePacketTag(tag);
+				tag.DropPacket();
+				p->AddPacketTag(tag);
+			}
+			delay += egress->m_switch_propagation_delay;
+			hop = egress;
+		}
+		if (!m_dropTrace.IsEmpty())
+		{
+			m_dropTrace(p->Copy());
+		}
+	}
+
 	void
 	OpticalDevice::PassThrough(Ptr<Packet> p, Ptr<OpticalDevice> src)
 	{
-		NS_LOG_FUNCTION(this << p);
-		if (!m_is_reconfiguring)
+		OPTICAL_HOT_LOG_FUNCTION(this << p);
+		OpticalProfiler::Scope profile(OpticalProfiler::PASS_THROUGH,
+									   m_is_endpoint);
+		Time now = DynamicCast<TimeNode>(m_node)->GetLocalTime();
+		if (m_awgr || m_signalling != SLOTTED || 
+			!m_clock->IsReconfiguring(now))
 		{
 			OpticalTag tag;
 			bool found_tag = p->PeekPacketTag(tag);
@@ -1248,6 +1888,7 @@ namespace ns3
 				}
 			}
 			src->m_channels[channel]++;
+			AddressData(p);
 			
 			Simulator::Schedule(m_switch_propagation_delay + tx_time,
 								&OpticalDevice::PassThroughFinish,
@@ -1263,14 +1904,19 @@ namespace ns3
 		}
 		else
 		{
-			m_dropTrace(p->Copy());
+			if (!m_dropTrace.IsEmpty())
+			{
+				m_dropTrace(p->Copy());
+			}
 		}
 	}
 
 	void
 	OpticalDevice::PassThroughFinish(Ptr<Packet> p, Ptr<OpticalDevice> src)
 	{
-		NS_LOG_FUNCTION(this << p);
+		OPTICAL_HOT_LOG_FUNCTION(this << p);
+		OpticalProfiler::Scope profile(OpticalProfiler::PASS_THROUGH_FINISH,
+									   m_is_endpoint);
 		OpticalTag tag;
 		bool found_tag = p->PeekPacketTag(tag);
 		NS_ASSERT_MSG(found_tag, "Packet did not have optial tag.");
@@ -1285,33 +1931,37 @@ namespace ns3
 		NS_ASSERT_MSG(iter != m_packet_map[channel].end(),
 					  "Did not find packet in map.");
 		m_packet_map[channel].erase(iter);
-		// erase from dest
-		auto& tx_list = m_tx_list.begin()->second[channel];
-		for (auto item = tx_list.begin(); item != tx_list.end(); ++item)
-		{
-			if (item->id == id)
-			{	
-				item = tx_list.erase(item);
-				break;
-			}
-		}
-		// erase from src
-		tx_list = src->m_tx_list.begin()->second[channel];
-		for (auto item = tx_list.begin(); item != tx_list.end(); ++item)
-		{
-			if (item->id == id)
-			{	
-				item = tx_list.erase(item);
-				break;
-			}
-		}
+		Time now = DynamicCast<TimeNode>(m_node)->GetLocalTime();
+		m_clock->Expire(now);
+		m_clock->Release(now, m_if_index, channel, id);
+		m_clock->Release(now, src->m_if_index, channel, id);
 	}
 
 	void
 	OpticalDevice::UpdateRoutes(bool first)
 	{
 		NS_LOG_FUNCTION(this << first);
+		Ptr<TimeNode> node = DynamicCast<TimeNode>(m_node);
+		if (first && !m_node->GetObject<OpticalSlotClock>())
+		{
+			m_node->AggregateObject(CreateObject<OpticalSlotClock>());
+		}
+		m_clock = m_node->GetObject<OpticalSlotClock>();
+		m_awgr = m_node->GetObject<OpticalAwgr>();
+		m_clock->SetSlotted(m_signalling == SLOTTED);
+		m_clock->Configure(m_reconfigure_time, m_timeslot_duration, 
+						   m_schedule_size, m_node->GetNDevices(),
+						   m_channel->GetNChannels());
+		if (first)
+		{
+			m_clock->Start(node->GetLocalTime());
+			if (m_awgr)
+			{
+				m_awgr->Build(m_node);
+			}
+		}
 		m_route_table.clear();
+		m_paths.clear();
 		for (uint32_t i = 0; i < m_node->GetNDevices(); i++)
 		{
 			Ptr<NetDevice> device = m_node->GetDevice(i);
@@ -1330,14 +1980,16 @@ namespace ns3
 				}
 			}
 		}
-		BeginReconfigure();
+		m_next_transmit = m_clock->GetSlotStart(0);
 	}
 
 	bool
 	OpticalDevice::ScheduleMessage(Time arrival, Address dest, uint32_t id, 
 								   uint8_t channel, Time tx_delay, int from)
 	{
-		NS_LOG_FUNCTION(this << arrival << dest << channel);
+		OPTICAL_HOT_LOG_FUNCTION(this << arrival << dest << channel);
+		OpticalProfiler::Scope profile(OpticalProfiler::SCHEDULE_MESSAGE,
+									   m_is_endpoint);
 		bool success = false;
 		Ptr<NetDevice> base_dev = m_node->GetDevice(from);
 		Ptr<OpticalDevice> from_dev = DynamicCast<OpticalDevice>(base_dev);
@@ -1347,143 +1999,430 @@ namespace ns3
 					  "Address not found.");
 		int dev = iter->second;
 		NS_ASSERT_MSG(dev >= 0, "Invalid device id.");
-		for (auto& pair : from_dev->m_schedule_table)
+		if (m_awgr)
+		{
+			return m_awgr->GetRoute(from, channel) == dev;
+		}
+		Time now = DynamicCast<TimeNode>(m_node)->GetLocalTime();
+		if (m_signalling != SLOTTED)
 		{
-			Time timeslot = pair.first;
-			if (arrival >= timeslot && 
-				arrival + tx_delay <= timeslot + m_timeslot_duration)
+			// The offset left must cover the switch setup
+			if (arrival - now < m_reconfigure_time)
 			{
-				// Check if source clear
-				auto src_iter = from_dev->m_tx_list.find(timeslot);
-				NS_ASSERT_MSG(src_iter != from_dev->m_tx_list.end(), 
-							  "Tx list should have same timeslots as sched.");
-				for(TransmissionItem& item : src_iter->second[channel])
-				{
-					Time a1 = item.arrival;
-					Time e1 = item.exit;
-					Time a2 = arrival;
-					Time e2 = arrival + tx_delay;
-					if ((a1 >= a2 && a1 <= e2) || (e1 >= a2 && e1 <= e2))
-					{
-						return false;
-					}
-				}
-				// Check if dest clear
-				auto dest_iter = m_tx_list.find(timeslot);
-				NS_ASSERT_MSG(dest_iter != m_tx_list.end(), 
-							  "Tx list should have same timeslots as sched.");
-				for(TransmissionItem& item : dest_iter->second[channel])
-				{
-					Time a1 = item.arrival;
-					Time e1 = item.exit;
-					Time a2 = arrival;
-					Time e2 = arrival + tx_delay;
-					if ((a1 >= a2 && a1 <= e2) || (e1 >= a2 && e1 <= e2))
-					{
-						return false;
-					}
-				}
-				
-				auto& entry = pair.second;
-				if (entry[channel] == -1)
-				{
-					entry[channel] = dev;
-				}
-				success = entry[channel] == dev;
-				
-				// Add packet to dest and src
-				if (success)
-				{
-					TransmissionItem item;
-					item.id = id;
-					item.arrival = arrival;
-					item.exit = arrival + tx_delay;
-					src_iter->second[channel].push_back(item);
-					dest_iter->second[channel].push_back(item);
-				}
-				break;
+				return false;
 			}
+			return m_clock->Reserve(GetHoldStart(arrival, now), 
+									arrival + tx_delay, from, m_if_index, 
+									channel, id, now);
+		}
+		int64_t index = m_clock->GetSlotIndex(arrival);
+		Time timeslot = m_clock->GetSlotStart(index);
+		if (!m_clock->IsInSchedule(now, index) ||
+			arrival + tx_delay > timeslot + m_timeslot_duration)
+		{
+			return false;
+		}
+		OpticalSlotClock::Slot* slot;
+		{
+			OpticalProfiler::Scope materialise(
+				OpticalProfiler::MATERIALISE_SLOT, m_is_endpoint);
+			m_clock->Expire(now);
+			slot = &m_clock->Materialise(timeslot);
+		}
+		// Check if source and dest clear
+		int64_t a2 = arrival.GetTimeStep();
+		int64_t e2 = (arrival + tx_delay).GetTimeStep();
+		if (slot->Overlaps(from, channel, a2, e2) ||
+			slot->Overlaps(m_if_index, channel, a2, e2))
+		{
+			return false;
+		}
+		
+		if (!m_clock->HasCapacity(*slot, from, channel, tx_delay) ||
+			!m_clock->HasCapacity(*slot, m_if_index, channel, tx_delay))
+		{
+			return false;
+		}
+		
+		if (slot->GetRoute(from, channel) == -1)
+		{
+			slot->SetRoute(from, channel, dev);
+		}
+		success = slot->GetRoute(from, channel) == dev;
+		
+		// Add packet to dest and src
+		if (success)
+		{
+			slot->AddBurst(from, channel, id, a2, e2);
+			slot->AddBurst(m_if_index, channel, id, a2, e2);
 		}
 		return success;
 	}
 
-	int
-	OpticalDevice::GetOpticalRoute(uint8_t channel)
+	Time
+	OpticalDevice::GetHoldStart(Time arrival, Time now) const
 	{
-		NS_LOG_FUNCTION(this << channel);
-		return m_schedule_table.begin()->second[channel];
+		return (m_signalling == JIT) ? now : arrival - m_reconfigure_time;
 	}
 
-	void
-	OpticalDevice::BeginReconfigure()
+	Time
+	OpticalDevice::GetArrival(uint64_t message_sent) const
 	{
-		NS_LOG_FUNCTION(this);
-		NS_ASSERT_MSG(!m_is_reconfiguring, "Should not be reconfiguring");
-		m_is_reconfiguring = true;
-		Ptr<TimeNode> node = DynamicCast<TimeNode>(m_node);
-		Time current = node->GetLocalTime() + m_reconfigure_time;
-		if (m_schedule_table.empty())
+		return Time::FromInteger(message_sent, Time::NS) + 
+			m_channel->GetDelay();
+	}
+
+	uint32_t
+	OpticalDevice::GetSlotOccupancy(Time arrival, uint8_t channel) const
+	{
+		if (!m_clock)
+		{
+			return 0;
+		}
+		Time timeslot = m_clock->GetSlotStart(m_clock->GetSlotIndex(arrival));
+		const OpticalSlotClock::Slot* slot = m_clock->Find(timeslot);
+		if (!slot || channel >= slot->GetWidth())
+		{
+			return 0;
+		}
+		return slot->GetNBursts(m_if_index, channel);
+	}
+
+	uint64_t
+	OpticalDevice::GetFreeChannels(Time arrival, Address dest, Time tx_delay,
+								   int from) const
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << arrival << dest << from);
+		Ptr<OpticalDevice> from_dev = 
+			DynamicCast<OpticalDevice>(m_node->GetDevice(from));
+		auto iter = from_dev->m_route_table.find(
+			Mac48Address::ConvertFrom(dest));
+		if (iter == from_dev->m_route_table.end())
+		{
+			return 0;
+		}
+		int dev = iter->second;
+		uint8_t channels = std::min(m_channel->GetNChannels(), 
+									from_dev->m_channel->GetNChannels());
+		// Bits 1 to channels, bit 0 is the control channel
+		uint64_t lanes = (uint64_t(2) << std::min<uint8_t>(channels, 63)) - 2;
+		if (m_awgr)
+		{
+			uint64_t free = 0;
+			for (uint8_t c = 1; c <= channels && c < 64; c++)
+			{
+				free |= static_cast<uint64_t>(
+					m_awgr->GetRoute(from, c) == dev) << c;
+			}
+			return free;
+		}
+		Time now = DynamicCast<TimeNode>(m_node)->GetLocalTime();
+		if (m_signalling != SLOTTED)
+		{
+			if (arrival - now < m_reconfigure_time)
+			{
+				return 0;
+			}
+			const OpticalSlotClock::Slot& bursts = m_clock->GetBursts();
+			int64_t hold = GetHoldStart(arrival, now).GetTimeStep();
+			int64_t exit = (arrival + tx_delay).GetTimeStep();
+			return lanes & bursts.GetFreeChannels(from, hold, exit) & 
+				bursts.GetFreeChannels(m_if_index, hold, exit);
+		}
+		int64_t index = m_clock->GetSlotIndex(arrival);
+		Time timeslot = m_clock->GetSlotStart(index);
+		if (!m_clock->IsInSchedule(now, index) ||
+			arrival + tx_delay > timeslot + m_timeslot_duration)
+		{
+			return 0;
+		}
+		// Only a query, a slot nobody reserved in yet has every lane free
+		const OpticalSlotClock::Slot* slot = m_clock->Find(timeslot);
+		if (!slot)
 		{
-			for (int t = 0; t < m_schedule_size; t++)
+			uint64_t free = lanes;
+			for (uint8_t c = 1; c <= channels && c < 64; c++)
 			{
-				Time timeslot = 
-					current + ((m_reconfigure_time + m_timeslot_duration) * t);
-				std::vector<int> sched_entry;
-				std::vector<std::vector<TransmissionItem>> tx_entry;
-				for (size_t d = 0; d <= m_channel->GetNChannels(); d++)
+				if (!m_clock->HasCapacity(from, c, tx_delay) ||
+					!m_clock->HasCapacity(m_if_index, c, tx_delay))
 				{
-					sched_entry.push_back(-1);
-					std::vector<TransmissionItem> tx_item;
-					tx_entry.push_back(tx_item);
+					free &= ~(uint64_t(1) << c);
 				}
-				m_schedule_table.insert({timeslot, sched_entry});
-				m_tx_list.insert({timeslot, tx_entry});
 			}
+			return free;
 		}
-		else
+		int64_t a2 = arrival.GetTimeStep();
+		int64_t e2 = (arrival + tx_delay).GetTimeStep();
+		uint64_t free = lanes & slot->GetFreeChannels(from, a2, e2) &
+			slot->GetFreeChannels(m_if_index, a2, e2);
+		for (uint8_t c = 1; c <= channels && c < 64; c++)
 		{
-			m_schedule_table.erase(m_schedule_table.begin());
-			m_tx_list.erase(m_tx_list.begin());
-			for (const auto& it : m_schedule_table)
+			uint64_t bit = uint64_t(1) << c;
+			if (!(free & bit))
 			{
-				Time slot = it.first;
-				auto values = it.second;
-				NS_ASSERT_MSG(slot == slot, "slot exists");
-				NS_ASSERT_MSG(values == values, "values exist");
+				continue;
 			}
-			Time timeslot = current + ((m_reconfigure_time + 
-				m_timeslot_duration) * (m_schedule_size - 1));
-			std::vector<int> sched_entry;
-			std::vector<std::vector<TransmissionItem>> tx_entry;
-			for (size_t d = 0; d <= m_channel->GetNChannels(); d++)
+			int bound = slot->GetRoute(from, c);
+			if ((bound != -1 && bound != dev) ||
+				!m_clock->HasCapacity(*slot, from, c, tx_delay) ||
+				!m_clock->HasCapacity(*slot, m_if_index, c, tx_delay))
 			{
-				sched_entry.push_back(-1);
-				std::vector<TransmissionItem> tx_item;
-				tx_entry.push_back(tx_item);
+				free &= ~bit;
 			}
-			m_schedule_table.insert({timeslot, sched_entry});
-			m_tx_list.insert({timeslot, tx_entry});
 		}
+		return free;
+	}
 
-		if (m_next_transmit < m_schedule_table.begin()->first)
+	uint32_t
+	OpticalDevice::GetEcmpScore(Ptr<OpticalDevice> from_dev, 
+								uint64_t message_sent, uint8_t channel, 
+								Time tx_delay) const
+	{
+		uint32_t blocked = std::numeric_limits<uint32_t>::max();
+		if (!m_is_link_up || IsControlFull())
 		{
-			m_next_transmit = m_schedule_table.begin()->first;
+			return blocked;
+		}
+		Time arrival = GetArrival(message_sent);
+		auto route = from_dev->m_route_table.find(
+			Mac48Address::ConvertFrom(GetRemote()));
+		if (route == from_dev->m_route_table.end())
+		{
+			return blocked;
+		}
+		if (m_awgr)
+		{
+			int egress = m_awgr->GetRoute(from_dev->m_if_index, channel);
+			return (egress == route->second) ? 0 : blocked;
+		}
+		Time now = DynamicCast<TimeNode>(m_node)->GetLocalTime();
+		if (m_signalling != SLOTTED)
+		{
+			const OpticalSlotClock::Slot& bursts = m_clock->GetBursts();
+			int64_t hold = GetHoldStart(arrival, now).GetTimeStep();
+			int64_t exit = (arrival + tx_delay).GetTimeStep();
+			if (arrival - now < m_reconfigure_time || 
+				bursts.Overlaps(from_dev->m_if_index, channel, hold, exit) ||
+				bursts.Overlaps(m_if_index, channel, hold, exit))
+			{
+				return blocked;
+			}
+			return 1 + bursts.GetNBursts(m_if_index, channel);
 		}
+		int64_t index = m_clock->GetSlotIndex(arrival);
+		Time timeslot = m_clock->GetSlotStart(index);
+		if (!m_clock->IsInSchedule(now, index) ||
+			arrival + tx_delay > timeslot + m_timeslot_duration)
+		{
+			return blocked;
+		}
+		// The ingress channel may already be bound to one port
+		const OpticalSlotClock::Slot* slot = m_clock->Find(timeslot);
+		int bound = slot ? slot->GetRoute(from_dev->m_if_index, channel) : -1;
+		if (bound == route->second)
+		{
+			return 0;
+		}
+		if (bound != -1)
+		{
+			return blocked;
+		}
+		return 1 + GetSlotOccupancy(arrival, channel);
+	}
 
-		Simulator::Schedule(m_reconfigure_time, 
-							&OpticalDevice::CompleteReconfigure,
-							this);
-		Simulator::Schedule(m_timeslot_duration + m_reconfigure_time,
-							&OpticalDevice::BeginReconfigure,
-							this);
+	Ptr<OpticalDevice>
+	OpticalDevice::SelectEcmpEgress(uint64_t message_sent, uint8_t channel, 
+									Time tx_delay, int from)
+	{
+		Ptr<OpticalDevice> from_dev = 
+			DynamicCast<OpticalDevice>(m_node->GetDevice(from));
+		Ptr<OpticalDevice> best = this;
+		uint32_t best_score = 
+			GetEcmpScore(from_dev, message_sent, channel, tx_delay);
+		for (uint32_t i = 0; i < m_node->GetNDevices() && best_score > 0; i++)
+		{
+			Ptr<OpticalDevice> candidate = 
+				DynamicCast<OpticalDevice>(m_node->GetDevice(i));
+			if (!candidate || candidate == this || candidate == from_dev ||
+				candidate->m_ecmp_group != m_ecmp_group)
+			{
+				continue;
+			}
+			uint32_t score = candidate->GetEcmpScore(from_dev, message_sent, 
+													 channel, tx_delay);
+			if (score < best_score)
+			{
+				best = candidate;
+				best_score = score;
+			}
+		}
+		return best;
 	}
 
-	void
-	OpticalDevice::CompleteReconfigure()
+	uint64_t
+	OpticalDevice::GetEcmpMovedCount() const
 	{
-		NS_LOG_FUNCTION(this);
-		NS_ASSERT_MSG(m_is_reconfiguring, "Should be reconfiguring.");
-		m_is_reconfiguring = false;
+		return m_ecmp_moved_count;
+	}
+
+	uint64_t
+	OpticalDevice::GetLateDropCount() const
+	{
+		return m_late_drop_count;
+	}
+
+	Ptr<OpticalSlotClock>
+	OpticalDevice::GetSlotClock() const
+	{
+		return m_clock;
+	}
+
+	int
+	OpticalDevice::GetOpticalRoute(uint8_t channel)
+	{
+		OPTICAL_HOT_LOG_FUNCTION(this << channel);
+		Time now = DynamicCast<TimeNode>(m_node)->GetLocalTime();
+		return GetOpticalRoute(channel, now);
+	}
+
+	int
+	OpticalDevice::GetOpticalRoute(uint8_t channel, Time now) const
+	{
+		if (m_awgr)
+		{
+			return m_awgr->GetRoute(m_if_index, channel);
+		}
+		if (m_signalling != SLOTTED)
+		{
+			return m_clock->GetBurstRoute(m_if_index, channel, now);
+		}
+		const OpticalSlotClock::Slot* slot = 
+			m_clock->Find(m_clock->GetSlotStart(m_clock->GetCurrentSlot(now)));
+		if (!slot || channel >= slot->GetWidth())
+		{
+			return -1;
+		}
+		return slot->GetRoute(m_if_index, channel);
+	}
+
+	MemoryUsage
+	OpticalDevice::GetMemoryUsage() const
+	{
+		MemoryUsage usage;
+		uint64_t packet_map = memory::VectorBytes(m_packet_map);
+		for (const auto& map : m_packet_map)
+		{
+			packet_map += memory::MapBytes(map);
+			for (const auto& item : map)
+			{
+				packet_map += sizeof(Packet) + item.second->GetSize();
+			}
+		}
+		usage.push_back({"m_packet_map", packet_map});
+		usage.push_back({"m_expected", memory::ListBytes(m_expected)});
+		usage.push_back({"m_received", memory::ListBytes(m_received)});
+		uint64_t sent_table = memory::MapBytes(m_sent_table);
+		for (const auto& item : m_sent_table)
+		{
+			sent_table += sizeof(Packet) + item.second.packet->GetSize();
+		}
+		usage.push_back({"m_sent_table", sent_table});
+		usage.push_back({"m_channels", memory::VectorBytes(m_channels)});
+		usage.push_back({"m_route_table", memory::MapBytes(m_route_table)});
+		uint64_t control_queue = 0;
+		if (m_control_queue)
+		{
+			control_queue = m_control_queue->GetNBytes() + 
+				m_control_queue->GetNPackets() * sizeof(Packet);
+		}
+		usage.push_back({"m_control_queue", control_queue});
+		uint64_t control_edf = memory::MultimapBytes(m_control_edf);
+		for (const auto& item : m_control_edf)
+		{
+			control_edf += sizeof(Packet) + item.second.packet->GetSize();
+		}
+		usage.push_back({"m_control_edf", control_edf});
+		return usage;
+	}
+
+	uint64_t
+	OpticalDevice::GetMemoryFootprint() const
+	{
+		return memory::TotalBytes(GetMemoryUsage());
+	}
+
+	uint32_t
+	OpticalDevice::GetControlQueueDepth() const
+	{
+		if (m_control_scheduler == EDF)
+		{
+			return m_control_edf.size();
+		}
+		return m_control_queue ? m_control_queue->GetNPackets() : 0;
+	}
+
+	uint32_t
+	OpticalDevice::GetReservationCount() const
+	{
+		uint32_t count = 0;
+		if (!m_clock)
+		{
+			return count;
+		}
+		for (const auto& slot : m_clock->GetCalendar())
+		{
+			for (uint32_t ch = 0; ch < slot.second.GetWidth(); ch++)
+			{
+				count += slot.second.GetNBursts(m_if_index, ch);
+			}
+		}
+		const OpticalSlotClock::Slot& bursts = m_clock->GetBursts();
+		for (uint32_t ch = 0; ch < bursts.GetWidth(); ch++)
+		{
+			count += bursts.GetNBursts(m_if_index, ch);
+		}
+		return count;
+	}
+
+	uint32_t
+	OpticalDevice::GetPeakChannelReservations() const
+	{
+		uint32_t peak = 0;
+		if (!m_clock)
+		{
+			return peak;
+		}
+		for (const auto& slot : m_clock->GetCalendar())
+		{
+			for (uint32_t ch = 0; ch < slot.second.GetWidth(); ch++)
+			{
+				peak = std::max(peak, 
+								slot.second.GetNBursts(m_if_index, ch));
+			}
+		}
+		const OpticalSlotClock::Slot& bursts = m_clock->GetBursts();
+		for (uint32_t ch = 0; ch < bursts.GetWidth(); ch++)
+		{
+			peak = std::max(peak, bursts.GetNBursts(m_if_index, ch));
+		}
+		return peak;
+	}
+
+	uint32_t
+	OpticalDevice::GetInFlightCount() const
+	{
+		uint32_t count = m_sent_table.size();
+		for (const auto& map : m_packet_map)
+		{
+			count += map.size();
+		}
+		return count;
+	}
+
+	uint64_t
+	OpticalDevice::GetNackCount() const
+	{
+		return m_nack_count;
 	}
 
 	void
@@ -1496,8 +2435,7 @@ namespace ns3
 		for (int i = 0; i <= channels; i++)
 		{
 			m_channels.push_back(0);
-			std::map<uint32_t, Ptr<Packet>> packet_map;
-			m_packet_map.push_back(packet_map);
+			m_packet_map.emplace_back();
 		}
 	}
 }
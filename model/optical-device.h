@@ -4,6 +4,7 @@
 #include "ns3/address.h"
 #include "ns3/callback.h"
 #include "ns3/data-rate.h"
+#include "ns3/ipv4-header.h"
 #include "ns3/mac48-address.h"
 #include "ns3/net-device.h"
 #include "ns3/node.h"
@@ -11,8 +12,11 @@
 #include "ns3/packet.h"
 #include "ns3/ptr.h"
 #include "ns3/traced-callback.h"
+#include "ns3/optical-awgr.h"
 #include "ns3/optical-channel.h"
 #include "ns3/optical-control-header.h"
+#include "ns3/optical-memory.h"
+#include "ns3/optical-slot-clock.h"
 #include "ns3/queue.h"
 #include "ns3/object-factory.h"
 
@@ -30,17 +34,61 @@ namespace ns3
 			EventId check_event;
 	};
 
-	class TransmissionItem
+	class ControlItem
 	{
 		public:
-			uint32_t id;
-			Time arrival;
-			Time exit;
+			Ptr<Packet> packet;
+			bool reservation;
+	};
+
+	class PathItem
+	{
+		public:
+			// Channels every AWGR on the path routes along it
+			uint64_t channels;
+			// Switches crossed, 0 if the path could not be walked
+			uint32_t switches;
 	};
 
 	class OpticalDevice : public NetDevice
 	{
 		public:
+			/**
+			 * Order in which queued control packets are transmitted. EDF
+			 * sends the packet with the earliest deadline first and drops
+			 * reservations whose burst can no longer be reserved in time.
+			 */
+			enum ControlScheduler
+			{
+				FIFO,
+				EDF
+			};
+			/**
+			 * How an endpoint picks the wavelength of a burst. FIRST_FIT
+			 * and LEAST_LOADED only pick among the channels still free
+			 * on the first switch of the path.
+			 */
+			enum ChannelSelection
+			{
+				RANDOM_CHANNEL,
+				FIRST_FIT,
+				LEAST_LOADED
+			};
+			/**
+			 * How reservations are timed. SLOTTED reserves bursts in the
+			 * timeslots of the slot clock. JET (just enough time) holds the
+			 * ports of a switch from one reconfiguration before the burst
+			 * until it has passed, JIT (just in time) from the moment the
+			 * reservation is processed. Both reserve each burst for its own
+			 * interval without slots.
+			 */
+			enum Signalling
+			{
+				SLOTTED,
+				JET,
+				JIT
+			};
+
 			static TypeId GetTypeId();
 			OpticalDevice();
 			~OpticalDevice();
@@ -97,9 +145,46 @@ namespace ns3
 			
 			void UpdateRoutes(bool first);
 			void UpdateChannels();
+
+			MemoryUsage GetMemoryUsage() const;
+			uint64_t GetMemoryFootprint() const;
+
+			uint32_t GetControlQueueDepth() const;
+			uint32_t GetReservationCount() const;
+			uint32_t GetPeakChannelReservations() const;
+			uint32_t GetInFlightCount() const;
+			uint64_t GetNackCount() const;
+			uint32_t GetSlotOccupancy(Time arrival, uint8_t channel) const;
+			/**
+			 * @brief The channels a burst could reserve through this port,
+			 * the admission check of ScheduleMessage for every channel at
+			 * once.
+			 * @param arrival the local time the burst reaches the switch.
+			 * @param dest the address of the next hop.
+			 * @param tx_delay the duration of the burst.
+			 * @param from the ifindex of the ingress port.
+			 * @return A mask with bit c set if channel c would be admitted.
+			 */
+			uint64_t GetFreeChannels(Time arrival, Address dest, 
+									 Time tx_delay, int from) const;
+			uint64_t GetEcmpMovedCount() const;
+			uint64_t GetLateDropCount() const;
+
+			// Used by the test suite and optical-benchmark to drive the
+			// data plane without a full simulation
+			Ptr<OpticalSlotClock> GetSlotClock() const;
+			Address GetRemote() const;
+			bool ScheduleMessage(Time arrival, Address dest, uint32_t id, 
+								 uint8_t channel, Time tx_delay, int from);
+			int GetOpticalRoute(uint8_t channel);
+			Time SplitPacket(Ptr<Packet> data, Ptr<Packet>& control, 
+							 uint16_t protocol, uint32_t id);
+			Time GetPacketTransmitTime(Time& tx_ctrl, Time& tx_data,
+										uint32_t switches);
+			bool ControlSend(Ptr<Packet> packet, uint8_t msg_type, 
+							 Time data_time);
 		private:
 			void DoDispose() override;
-			Address GetRemote() const;
 			void AddControlHeader(Ptr<Packet> p,
 								  uint16_t protocol,
 								  uint32_t id,
@@ -118,28 +203,67 @@ namespace ns3
 			void ControlTransmitComplete();
 			void DataTransmitStart(Ptr<Packet> p);
 			void DataTransmitComplete();
+			void FastForward(Ptr<Packet> p, Time tx_time);
 			void PassThrough(Ptr<Packet> p, Ptr<OpticalDevice> src);
 			void PassThroughFinish(Ptr<Packet> p, Ptr<OpticalDevice> src);
 			bool InternalSend(Ptr<Packet> packet, uint16_t protocol, 
 							  uint32_t id);
-			bool ControlSend(Ptr<Packet> packet);
+			bool IsControlFull() const;
+			Ptr<Packet> DequeueControl();
 			void CheckSent(uint32_t id);
 			void FinalCallback(Ptr<Packet> p, uint16_t protocol);
 			void SendCTRL(Ptr<Packet> copy, uint16_t protocol, uint32_t id,
 						  uint8_t msg_type);
-			Time SplitPacket(Ptr<Packet> data, Ptr<Packet>& control, 
-							 uint16_t protocol, uint32_t id);
+			void SendReply(Ptr<Packet> copy, uint16_t protocol, uint32_t id,
+						   uint8_t msg_type, uint64_t message_send,
+						   uint64_t duration, uint8_t channel);
+			/**
+			 * @brief Free the hold of a refused burst leaving through this
+			 * port and send the release out of the port it was reserved
+			 * from.
+			 * @param packet the udp header and control payload.
+			 * @param ipv4_header the header addressed to the source.
+			 * @param protocol the protocol number.
+			 * @return False if this port holds no such reservation.
+			 */
+			bool ReturnRelease(Ptr<Packet> packet, 
+							   const Ipv4Header& ipv4_header,
+							   uint16_t protocol);
+			int GetReservedIngress(Time arrival, uint8_t channel, 
+								   uint32_t id) const;
 			void CopyTags(Ptr<Packet> original, Ptr<Packet> copy);
-			Time GetPacketTransmitTime(Time& tx_ctrl, Time& tx_data);
 			uint8_t GetRandomChannel();
-			uint64_t BytesToUint64(uint8_t* buffer, int offset);
-			uint32_t BytesToUint32(uint8_t* buffer, int offest);
-			uint16_t BytesToUint16(uint8_t* buffer, int offest);
+			// A random channel of a mask with bit c set for channel c
+			uint8_t GetRandomChannel(uint64_t mask);
+			/**
+			 * @brief Walk the routed path to a destination, cached per
+			 * destination once it reaches the endpoint.
+			 * @param header the ipv4 header of the message.
+			 * @return The channels that reach the destination, 0 if none
+			 * does, and the number of switches crossed.
+			 */
+			PathItem GetPath(const Ipv4Header& header);
+			// The port a switch routes a message out of
+			Ptr<OpticalDevice> GetRouteEgress(const Ipv4Header& header) const;
+			uint8_t SelectChannel(uint64_t message_sent, Time tx_data, 
+								  const Ipv4Header& header);
 			void UpdateReceived(Ptr<Packet> copy, uint16_t protocol, 
 								uint32_t id);
+			Mac48Address GetNextHop(const Ipv4Header& header) const;
+			void AddressTag(Ptr<Packet> p, const Ipv4Header& header) const;
+			void AddressData(Ptr<Packet> p) const;
 
 			uint16_t m_dev_id;
 			uint16_t m_msg_count;
+			uint32_t m_max_received;
+			uint64_t m_nack_count;
+			uint32_t m_ecmp_group;
+			uint64_t m_ecmp_moved_count;
+			ControlScheduler m_control_scheduler;
+			uint64_t m_late_drop_count;
+			bool m_fast_forward;
+			ChannelSelection m_channel_selection;
+			Signalling m_signalling;
 			
 			float m_failure_rate;
 
@@ -149,7 +273,6 @@ namespace ns3
 			bool m_is_link_up;
 			bool m_is_transmitting_control;
 			bool m_is_transmitting_data; //Only for Endpoint
-			bool m_is_reconfiguring;
 			uint32_t m_mtu;
 			DataRate m_control_bps;
 			DataRate m_data_bps; //Only for Endpoint
@@ -165,6 +288,8 @@ namespace ns3
 			Ptr<Node> m_node;
 			Mac48Address m_address;
 			Ptr<Queue<Packet>> m_control_queue;
+			memory::PoolMultimap<Time, ControlItem> m_control_edf;
+			uint32_t m_control_edf_bytes;
 
 			TracedCallback<> m_linkChangeCallbacks;
 			TracedCallback<Ptr<const Packet>> m_dropTrace;
@@ -176,22 +301,29 @@ namespace ns3
 			NetDevice::ReceiveCallback m_rxCallback;
 			NetDevice::PromiscReceiveCallback m_promiscCallback;
 
-			std::vector<std::map<uint32_t, Ptr<Packet>>> m_packet_map;
+			std::vector<memory::PoolMap<uint32_t, Ptr<Packet>>> m_packet_map;
 			std::list<uint32_t> m_expected; //Only for Endpoint
 			std::list<uint32_t> m_received; //Opnly for Endpoint
-			std::map<uint32_t, ScheduleItem> m_sent_table; //Only for Endpoint
+			memory::PoolMap<uint32_t, ScheduleItem> m_sent_table; //Only for Endpoint
 			std::vector<uint8_t> m_channels;
 			Time m_next_transmit;
 			uint16_t m_schedule_size;
 			std::map<Mac48Address, int> m_route_table;
-			std::map<Time, std::vector<int>> m_schedule_table;
-			std::map<Time, std::vector<std::vector<TransmissionItem>>> 
-				m_tx_list;
-			bool ScheduleMessage(Time arrival, Address dest, uint32_t id, 
-								 uint8_t channel, Time tx_delay, int from);
-			int GetOpticalRoute(uint8_t channel);
-			void BeginReconfigure();
-			void CompleteReconfigure();
+			std::map<Ipv4Address, PathItem> m_paths; //Only for Endpoint
+			Ptr<OpticalSlotClock> m_clock;
+			Ptr<OpticalAwgr> m_awgr;
+			// When a switch starts holding its ports for a burst
+			Time GetHoldStart(Time arrival, Time now) const;
+			// When a burst sent at message_sent reaches the switch this
+			// port leaves through
+			Time GetArrival(uint64_t message_sent) const;
+			int GetOpticalRoute(uint8_t channel, Time now) const;
+			uint32_t GetEcmpScore(Ptr<OpticalDevice> from_dev, 
+								  uint64_t message_sent, uint8_t channel, 
+								  Time tx_delay) const;
+			Ptr<OpticalDevice> SelectEcmpEgress(uint64_t message_sent, 
+												uint8_t channel, Time tx_delay,
+												int from);
 	};
 }
 
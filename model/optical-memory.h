@@ -0,0 +1,226 @@
+#ifndef OPTICAL_MEMORY_H
+#define OPTICAL_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <new>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+	/*
+	Container name and estimated heap bytes, reported by the optical
+	devices, channels and quantum applications for memory accounting.
+	*/
+	typedef std::vector<std::pair<std::string, uint64_t>> MemoryUsage;
+
+	namespace memory
+	{
+		// Red-black tree node links and colour, list node links
+		const uint64_t TREE_NODE_OVERHEAD = 4 * sizeof(void*);
+		const uint64_t LIST_NODE_OVERHEAD = 2 * sizeof(void*);
+
+		template <typename T>
+		inline uint64_t
+		VectorBytes(const std::vector<T>& v)
+		{
+			return v.capacity() * sizeof(T);
+		}
+
+		template <typename T>
+		inline uint64_t
+		ListBytes(const std::list<T>& l)
+		{
+			return l.size() * (sizeof(T) + LIST_NODE_OVERHEAD);
+		}
+
+		template <typename K, typename V, typename C, typename A>
+		inline uint64_t
+		MapBytes(const std::map<K, V, C, A>& m)
+		{
+			return m.size() * (sizeof(std::pair<const K, V>) +
+							   TREE_NODE_OVERHEAD);
+		}
+
+		template <typename K, typename V, typename C, typename A>
+		inline uint64_t
+		MultimapBytes(const std::multimap<K, V, C, A>& m)
+		{
+			return m.size() * (sizeof(std::pair<const K, V>) +
+							   TREE_NODE_OVERHEAD);
+		}
+
+		/*
+		Requests served by every PoolAllocator, and how many of them had to
+		go to the heap because no freed node was waiting.
+		*/
+		struct PoolCounters
+		{
+			uint64_t requests = 0;
+			uint64_t heap = 0;
+		};
+
+		inline PoolCounters&
+		GetPoolCounters()
+		{
+			static PoolCounters counters;
+			return counters;
+		}
+
+		/*
+		Whether freed nodes are kept for reuse, on by default. Only turned
+		off to measure the heap traffic the freelists save.
+		*/
+		inline bool&
+		GetPoolingEnabled()
+		{
+			static bool enabled = true;
+			return enabled;
+		}
+
+		// Empties the freelist of one node type
+		inline std::vector<std::function<void()>>&
+		GetFreeListReleasers()
+		{
+			static std::vector<std::function<void()>> releasers;
+			return releasers;
+		}
+
+		/*
+		Return every freed node kept by the PoolAllocators to the heap, so
+		a measurement starts from cold freelists.
+		*/
+		inline void
+		ReleaseFreeLists()
+		{
+			for (auto& release : GetFreeListReleasers())
+			{
+				release();
+			}
+		}
+
+		/*
+		Freelist allocator for the nodes of the per burst maps. Single node
+		allocations are taken from, and returned to, a list shared by every
+		container of the same node type, so once a simulation reaches its
+		steady state inserting a burst no longer calls the heap. The module
+		is single threaded like the simulator.
+		*/
+		template <typename T>
+		class PoolAllocator
+		{
+			public:
+				typedef T value_type;
+
+				PoolAllocator() = default;
+				template <typename U>
+				PoolAllocator(const PoolAllocator<U>&)
+				{
+				}
+
+				T*
+				allocate(std::size_t n)
+				{
+					PoolCounters& counters = GetPoolCounters();
+					counters.requests++;
+					std::vector<T*>& free = GetFreeList().nodes;
+					if (n == 1 && GetPoolingEnabled() && !free.empty())
+					{
+						T* node = free.back();
+						free.pop_back();
+						return node;
+					}
+					counters.heap++;
+					return static_cast<T*>(::operator new(n * sizeof(T)));
+				}
+
+				void
+				deallocate(T* p, std::size_t n)
+				{
+					if (n == 1 && GetPoolingEnabled())
+					{
+						GetFreeList().nodes.push_back(p);
+						return;
+					}
+					::operator delete(p);
+				}
+
+				static std::size_t
+				GetNFree()
+				{
+					return GetFreeList().nodes.size();
+				}
+			private:
+				struct FreeList
+				{
+					std::vector<T*> nodes;
+					FreeList()
+					{
+						GetFreeListReleasers().push_back([this]() {
+							Release();
+						});
+					}
+					~FreeList()
+					{
+						Release();
+					}
+					void
+					Release()
+					{
+						for (T* node : nodes)
+						{
+							::operator delete(node);
+						}
+						nodes.clear();
+					}
+				};
+
+				static FreeList&
+				GetFreeList()
+				{
+					static FreeList list;
+					return list;
+				}
+		};
+
+		template <typename T, typename U>
+		inline bool
+		operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+		{
+			return true;
+		}
+
+		template <typename T, typename U>
+		inline bool
+		operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+		{
+			return false;
+		}
+
+		template <typename K, typename V>
+		using PoolMap = std::map<K, V, std::less<K>,
+								 PoolAllocator<std::pair<const K, V>>>;
+
+		template <typename K, typename V>
+		using PoolMultimap = std::multimap<K, V, std::less<K>,
+									PoolAllocator<std::pair<const K, V>>>;
+
+		inline uint64_t
+		TotalBytes(const MemoryUsage& usage)
+		{
+			uint64_t total = 0;
+			for (const auto& item : usage)
+			{
+				total += item.second;
+			}
+			return total;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include "ns3/optical-profiler.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <iomanip>
+
+namespace ns3
+{
+	NS_LOG_COMPONENT_DEFINE("OpticalProfiler");
+
+	bool OpticalProfiler::s_enabled = false;
+	std::chrono::steady_clock::time_point OpticalProfiler::s_start;
+	uint64_t OpticalProfiler::s_count[NUM_HANDLERS][NUM_NODE_TYPES] = {};
+	uint64_t OpticalProfiler::s_nanos[NUM_HANDLERS][NUM_NODE_TYPES] = {};
+
+	void
+	OpticalProfiler::Enable()
+	{
+		NS_LOG_FUNCTION_NOARGS();
+		if (!s_enabled)
+		{
+			Reset();
+		}
+		s_enabled = true;
+	}
+
+	void
+	OpticalProfiler::Disable()
+	{
+		NS_LOG_FUNCTION_NOARGS();
+		s_enabled = false;
+	}
+
+	bool
+	OpticalProfiler::IsEnabled()
+	{
+		return s_enabled;
+	}
+
+	void
+	OpticalProfiler::Reset()
+	{
+		NS_LOG_FUNCTION_NOARGS();
+		for (int h = 0; h < NUM_HANDLERS; h++)
+		{
+			for (int t = 0; t < NUM_NODE_TYPES; t++)
+			{
+				s_count[h][t] = 0;
+				s_nanos[h][t] = 0;
+			}
+		}
+		s_start = std::chrono::steady_clock::now();
+	}
+
+	void
+	OpticalProfiler::Record(Handler handler, NodeType type, int64_t nanos)
+	{
+		s_count[handler][type]++;
+		s_nanos[handler][type] += static_cast<uint64_t>(nanos);
+	}
+
+	uint64_t
+	OpticalProfiler::GetCount(Handler handler, NodeType type)
+	{
+		return s_count[handler][type];
+	}
+
+	uint64_t
+	OpticalProfiler::GetNanoSeconds(Handler handler, NodeType type)
+	{
+		return s_nanos[handler][type];
+	}
+
+	const char*
+	OpticalProfiler::GetHandlerName(Handler handler)
+	{
+		switch (handler)
+		{
+			case RECEIVE:
+				return "Receive";
+			case PASS_THROUGH:
+				return "PassThrough";
+			case PASS_THROUGH_FINISH:
+				return "PassThroughFinish";
+			case SCHEDULE_MESSAGE:
+				return "ScheduleMessage";
+			case MATERIALISE_SLOT:
+				return "MaterialiseSlot";
+			case CHANNEL_PASS_THROUGH:
+				return "ChannelPassThrough";
+			case DATA_RECEIVE_CALLBACK:
+				return "DataReceiveCallback";
+			case FAST_FORWARD:
+				return "FastForward";
+			default:
+				return "Unknown";
+		}
+	}
+
+	void
+	OpticalProfiler::Print(std::ostream& os)
+	{
+		auto now = std::chrono::steady_clock::now();
+		double wall = std::chrono::duration<double>(now - s_start).count();
+		uint64_t events = Simulator::GetEventCount();
+		os << "ProfileWall," << std::fixed << std::setprecision(6) << wall
+		   << std::endl;
+		os << "ProfileEvents," << events << ","
+		   << (wall > 0 ? events / wall : 0.0) << std::endl;
+		os << "Profile,handler,node_type,count,total_ns,ns_per_event,"
+		   << "events_per_sec" << std::endl;
+		for (int h = 0; h < NUM_HANDLERS; h++)
+		{
+			for (int t = 0; t < NUM_NODE_TYPES; t++)
+			{
+				uint64_t count = s_count[h][t];
+				if (count == 0)
+				{
+					continue;
+				}
+				uint64_t nanos = s_nanos[h][t];
+				os << "Profile," << GetHandlerName(static_cast<Handler>(h))
+				   << "," << (t == ENDPOINT ? "endpoint" : "switch")
+				   << "," << count << "," << nanos << ","
+				   << std::setprecision(1)
+				   << static_cast<double>(nanos) / count << ","
+				   << (wall > 0 ? count / wall : 0.0) << std::endl;
+			}
+		}
+		os.unsetf(std::ios::floatfield);
+		os << std::setprecision(6);
+	}
+}
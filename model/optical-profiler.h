@@ -0,0 +1,99 @@
+#ifndef OPTICAL_PROFILER_H
+#define OPTICAL_PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace ns3
+{
+	/**
+	 * @ingroup quantum-network
+	 * @class OpticalProfiler
+	 * @brief Opt-in event counter and wall-clock profiler for module handlers.
+	 *
+	 * Handlers open a Scope on entry. While the profiler is disabled a Scope
+	 * only tests a flag, so the cost of leaving the scopes in place is a
+	 * single predictable branch per handler. Times are inclusive, a handler
+	 * called from another handler (PassThrough from Receive) is counted in
+	 * both.
+	 */
+	class OpticalProfiler
+	{
+		public:
+			enum Handler
+			{
+				RECEIVE = 0,
+				PASS_THROUGH,
+				PASS_THROUGH_FINISH,
+				SCHEDULE_MESSAGE,
+				MATERIALISE_SLOT,
+				CHANNEL_PASS_THROUGH,
+				DATA_RECEIVE_CALLBACK,
+				FAST_FORWARD,
+				NUM_HANDLERS
+			};
+
+			enum NodeType
+			{
+				ENDPOINT = 0,
+				SWITCH,
+				NUM_NODE_TYPES
+			};
+
+			class Scope
+			{
+				public:
+					Scope(Handler handler, bool is_endpoint)
+						: m_active(s_enabled)
+					{
+						if (m_active)
+						{
+							m_handler = handler;
+							m_type = is_endpoint ? ENDPOINT : SWITCH;
+							m_start = std::chrono::steady_clock::now();
+						}
+					}
+
+					~Scope()
+					{
+						if (m_active)
+						{
+							auto end = std::chrono::steady_clock::now();
+							OpticalProfiler::Record(m_handler, m_type,
+								std::chrono::duration_cast<
+									std::chrono::nanoseconds>(
+										end - m_start).count());
+						}
+					}
+				private:
+					bool m_active;
+					Handler m_handler;
+					NodeType m_type;
+					std::chrono::steady_clock::time_point m_start;
+			};
+
+			static void Enable();
+			static void Disable();
+			static bool IsEnabled();
+			static void Reset();
+			static uint64_t GetCount(Handler handler, NodeType type);
+			static uint64_t GetNanoSeconds(Handler handler, NodeType type);
+			static const char* GetHandlerName(Handler handler);
+			/**
+			 * @brief Print count, total time, ns/event and events/sec for
+			 * every handler that ran since the profiler was last reset.
+			 * @param os the stream the csv table is written to.
+			 */
+			static void Print(std::ostream& os);
+		private:
+			static void Record(Handler handler, NodeType type, int64_t nanos);
+
+			static bool s_enabled;
+			static std::chrono::steady_clock::time_point s_start;
+			static uint64_t s_count[NUM_HANDLERS][NUM_NODE_TYPES];
+			static uint64_t s_nanos[NUM_HANDLERS][NUM_NODE_TYPES];
+	};
+}
+
+#endif
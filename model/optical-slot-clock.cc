@@ -0,0 +1,720 @@
+#include "ns3/optical-slot-clock.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+	NS_LOG_COMPONENT_DEFINE("OpticalSlotClock");
+	NS_OBJECT_ENSURE_REGISTERED(OpticalSlotClock);
+
+	OpticalSlotClock::Slot::Slot()
+		: m_ports(0),
+		  m_width(0),
+		  m_capacity(4)
+	{
+	}
+
+	void
+	OpticalSlotClock::Slot::Reset(uint32_t ports, uint8_t channels)
+	{
+		m_ports = ports;
+		m_width = channels + 1;
+		size_t lanes = static_cast<size_t>(m_ports) * m_width;
+		m_routes.assign(lanes, -1);
+		m_background.assign(lanes, 0);
+		m_count.assign(lanes, 0);
+		m_ids.resize(lanes * m_capacity);
+		m_arrival.resize(lanes * m_capacity);
+		m_exit.resize(lanes * m_capacity);
+	}
+
+	uint32_t
+	OpticalSlotClock::Slot::GetNPorts() const
+	{
+		return m_ports;
+	}
+
+	uint32_t
+	OpticalSlotClock::Slot::GetWidth() const
+	{
+		return m_width;
+	}
+
+	int
+	OpticalSlotClock::Slot::GetRoute(uint32_t port, uint8_t channel) const
+	{
+		return m_routes[port * m_width + channel];
+	}
+
+	void
+	OpticalSlotClock::Slot::SetRoute(uint32_t port, uint8_t channel, 
+									 int egress)
+	{
+		m_routes[port * m_width + channel] = egress;
+	}
+
+	uint32_t
+	OpticalSlotClock::Slot::GetNBursts(uint32_t port, uint8_t channel) const
+	{
+		return m_count[port * m_width + channel];
+	}
+
+	bool
+	OpticalSlotClock::Slot::Overlaps(uint32_t port, uint8_t channel, 
+									 int64_t arrival, int64_t exit,
+									 uint32_t except) const
+	{
+		return LaneOverlaps(port * m_width + channel, arrival, exit, except);
+	}
+
+	uint64_t
+	OpticalSlotClock::Slot::GetFreeChannels(uint32_t port, int64_t arrival,
+											int64_t exit) const
+	{
+		NS_ASSERT_MSG(m_width <= 64, "Too many channels for a channel mask.");
+		// Channel 0 carries control and is never free for a burst
+		uint64_t busy = 1;
+		size_t first = port * m_width;
+		for (uint32_t c = 1; c < m_width; c++)
+		{
+			busy |= static_cast<uint64_t>(
+				LaneOverlaps(first + c, arrival, exit, NO_ID)) << c;
+		}
+		uint64_t lanes = (m_width == 64) ? ~uint64_t(0) : 
+			(uint64_t(1) << m_width) - 1;
+		return lanes & ~busy;
+	}
+
+	bool
+	OpticalSlotClock::Slot::LaneOverlaps(size_t lane, int64_t arrival, 
+										 int64_t exit, uint32_t except) const
+	{
+		size_t base = lane * m_capacity;
+		const uint32_t* ids = m_ids.data() + base;
+		const int64_t* arrivals = m_arrival.data() + base;
+		const int64_t* exits = m_exit.data() + base;
+		// No early exit so the compiler can vectorise the pass
+		bool overlap = false;
+		for (uint32_t i = 0; i < m_count[lane]; i++)
+		{
+			overlap |= (arrivals[i] <= exit) & (exits[i] >= arrival) & 
+					   (ids[i] != except);
+		}
+		return overlap;
+	}
+
+	bool
+	OpticalSlotClock::Slot::HasBurst(uint32_t port, uint8_t channel, 
+									 uint32_t id) const
+	{
+		size_t lane = port * m_width + channel;
+		size_t base = lane * m_capacity;
+		for (uint32_t i = 0; i < m_count[lane]; i++)
+		{
+			if (m_ids[base + i] == id)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint32_t
+	OpticalSlotClock::Slot::GetBurstAt(uint32_t port, uint8_t channel, 
+									   int64_t t) const
+	{
+		size_t lane = port * m_width + channel;
+		size_t base = lane * m_capacity;
+		for (uint32_t i = 0; i < m_count[lane]; i++)
+		{
+			if (m_arrival[base + i] <= t && m_exit[base + i] >= t)
+			{
+				return m_ids[base + i];
+			}
+		}
+		return NO_ID;
+	}
+
+	void
+	OpticalSlotClock::Slot::AddBurst(uint32_t port, uint8_t channel, 
+									 uint32_t id, int64_t arrival, 
+									 int64_t exit)
+	{
+		size_t lane = port * m_width + channel;
+		if (m_count[lane] == m_capacity)
+		{
+			Grow();
+		}
+		size_t index = lane * m_capacity + m_count[lane]++;
+		m_ids[index] = id;
+		m_arrival[index] = arrival;
+		m_exit[index] = exit;
+	}
+
+	bool
+	OpticalSlotClock::Slot::RemoveBurst(uint32_t port, uint8_t channel, 
+										uint32_t id)
+	{
+		size_t lane = port * m_width + channel;
+		size_t base = lane * m_capacity;
+		for (uint32_t i = 0; i < m_count[lane]; i++)
+		{
+			if (m_ids[base + i] == id)
+			{
+				size_t last = base + --m_count[lane];
+				m_ids[base + i] = m_ids[last];
+				m_arrival[base + i] = m_arrival[last];
+				m_exit[base + i] = m_exit[last];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void
+	OpticalSlotClock::Slot::RemoveEnded(uint32_t port, uint8_t channel, 
+										int64_t before, 
+										std::vector<uint32_t>& ended)
+	{
+		size_t lane = port * m_width + channel;
+		size_t base = lane * m_capacity;
+		uint32_t i = 0;
+		while (i < m_count[lane])
+		{
+			if (m_exit[base + i] < before)
+			{
+				ended.push_back(m_ids[base + i]);
+				size_t last = base + --m_count[lane];
+				m_ids[base + i] = m_ids[last];
+				m_arrival[base + i] = m_arrival[last];
+				m_exit[base + i] = m_exit[last];
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	int64_t
+	OpticalSlotClock::Slot::GetBusyTime(uint32_t port, uint8_t channel) const
+	{
+		size_t lane = port * m_width + channel;
+		size_t base = lane * m_capacity;
+		int64_t busy = 0;
+		for (uint32_t i = 0; i < m_count[lane]; i++)
+		{
+			busy += m_exit[base + i] - m_arrival[base + i];
+		}
+		return busy;
+	}
+
+	int64_t
+	OpticalSlotClock::Slot::GetBackground(uint32_t port, 
+										  uint8_t channel) const
+	{
+		return m_background[port * m_width + channel];
+	}
+
+	void
+	OpticalSlotClock::Slot::SetBackground(uint32_t port, uint8_t channel,
+										  int64_t steps)
+	{
+		m_background[port * m_width + channel] = steps;
+	}
+
+	uint64_t
+	OpticalSlotClock::Slot::GetMemoryBytes() const
+	{
+		return memory::VectorBytes(m_routes) + 
+			   memory::VectorBytes(m_background) +
+			   memory::VectorBytes(m_count) + memory::VectorBytes(m_ids) + 
+			   memory::VectorBytes(m_arrival) + memory::VectorBytes(m_exit);
+	}
+
+	void
+	OpticalSlotClock::Slot::Grow()
+	{
+		// Double the lanes and move every lane to its new offset
+		uint32_t capacity = m_capacity * 2;
+		size_t lanes = m_count.size();
+		std::vector<uint32_t> ids(lanes * capacity);
+		std::vector<int64_t> arrival(lanes * capacity);
+		std::vector<int64_t> exit(lanes * capacity);
+		for (size_t lane = 0; lane < lanes; lane++)
+		{
+			std::copy_n(m_ids.begin() + lane * m_capacity, m_count[lane],
+						ids.begin() + lane * capacity);
+			std::copy_n(m_arrival.begin() + lane * m_capacity, m_count[lane],
+						arrival.begin() + lane * capacity);
+			std::copy_n(m_exit.begin() + lane * m_capacity, m_count[lane],
+						exit.begin() + lane * capacity);
+		}
+		m_ids.swap(ids);
+		m_arrival.swap(arrival);
+		m_exit.swap(exit);
+		m_capacity = capacity;
+	}
+
+	TypeId
+	OpticalSlotClock::GetTypeId()
+	{
+		static TypeId tid =
+			TypeId("ns3::OpticalSlotClock")
+				.SetParent<Object>()
+				.SetGroupName("QuantumNetwork")
+				.AddConstructor<OpticalSlotClock>()
+				.AddAttribute("MemoryFootprint",
+							  "Estimated heap bytes held by the calendar.",
+							  TypeId::ATTR_GET,
+							  UintegerValue(0),
+							  MakeUintegerAccessor(
+							  		&OpticalSlotClock::GetMemoryFootprint),
+							  MakeUintegerChecker<uint64_t>());
+		return tid;
+	}
+
+	OpticalSlotClock::OpticalSlotClock()
+		: m_schedule_size(0),
+		  m_ports(0),
+		  m_channels(0),
+		  m_slotted(true)
+	{
+		NS_LOG_FUNCTION(this);
+	}
+
+	OpticalSlotClock::~OpticalSlotClock()
+	{
+		NS_LOG_FUNCTION(this);
+	}
+
+	void
+	OpticalSlotClock::Configure(Time reconfigure_time, Time timeslot_duration,
+								uint16_t schedule_size, uint32_t ports,
+								uint8_t channels)
+	{
+		NS_LOG_FUNCTION(this << reconfigure_time << timeslot_duration <<
+						schedule_size << ports << channels);
+		NS_ASSERT_MSG(m_ports == 0 ||
+					  (reconfigure_time == m_reconfigure_time &&
+					   timeslot_duration == m_timeslot_duration &&
+					   schedule_size == m_schedule_size),
+					  "Ports of a node must share the slot timing.");
+		NS_ASSERT_MSG((reconfigure_time + timeslot_duration).
+					  IsStrictlyPositive(),
+					  "Timeslot period must be positive.");
+		m_reconfigure_time = reconfigure_time;
+		m_timeslot_duration = timeslot_duration;
+		m_schedule_size = schedule_size;
+		m_ports = std::max(m_ports, ports);
+		m_channels = std::max(m_channels, channels);
+		// The first port of a node starts the clock before the others are
+		// configured, so the burst table grows to fit every port
+		if (!m_slotted && m_bursts.GetNPorts() > 0 &&
+			(m_bursts.GetNPorts() < m_ports || 
+			 m_bursts.GetWidth() < m_channels + 1u))
+		{
+			NS_ASSERT_MSG(m_burst_routes.empty(), 
+						  "Ports must be configured before bursts arrive.");
+			m_bursts.Reset(m_ports, m_channels);
+		}
+	}
+
+	void
+	OpticalSlotClock::Start(Time now)
+	{
+		NS_LOG_FUNCTION(this << now);
+		m_epoch = now + m_reconfigure_time;
+		m_calendar.clear();
+		m_spare.clear();
+		m_burst_routes.clear();
+		if (!m_slotted)
+		{
+			m_bursts.Reset(m_ports, m_channels);
+			return;
+		}
+		std::map<Time, Slot> slots;
+		for (int64_t i = 0; i <= m_schedule_size; i++)
+		{
+			slots[GetSlotStart(i)].Reset(m_ports, m_channels);
+		}
+		while (!slots.empty())
+		{
+			m_spare.push_back(slots.extract(slots.begin()));
+		}
+	}
+
+	void
+	OpticalSlotClock::SetSlotted(bool slotted)
+	{
+		NS_LOG_FUNCTION(this << slotted);
+		m_slotted = slotted;
+	}
+
+	bool
+	OpticalSlotClock::IsSlotted() const
+	{
+		return m_slotted;
+	}
+
+	int64_t
+	OpticalSlotClock::GetSlotIndex(Time t) const
+	{
+		int64_t period =
+			(m_reconfigure_time + m_timeslot_duration).GetTimeStep();
+		int64_t offset = (t - m_epoch).GetTimeStep();
+		int64_t index = offset / period;
+		if (offset % period < 0)
+		{
+			index--;
+		}
+		return index;
+	}
+
+	Time
+	OpticalSlotClock::GetSlotStart(int64_t index) const
+	{
+		return m_epoch + (m_reconfigure_time + m_timeslot_duration) * index;
+	}
+
+	int64_t
+	OpticalSlotClock::GetCurrentSlot(Time now) const
+	{
+		return GetSlotIndex(now + m_reconfigure_time);
+	}
+
+	bool
+	OpticalSlotClock::IsReconfiguring(Time now) const
+	{
+		Time shifted = now + m_reconfigure_time;
+		return shifted - GetSlotStart(GetSlotIndex(shifted)) <
+			m_reconfigure_time;
+	}
+
+	bool
+	OpticalSlotClock::IsInSchedule(Time now, int64_t index) const
+	{
+		int64_t first = GetCurrentSlot(now);
+		return index >= first && index < first + m_schedule_size;
+	}
+
+	uint16_t
+	OpticalSlotClock::GetScheduleSize() const
+	{
+		return m_schedule_size;
+	}
+
+	OpticalSlotClock::Slot*
+	OpticalSlotClock::Find(Time start)
+	{
+		auto iter = m_calendar.find(start);
+		return (iter != m_calendar.end()) ? &iter->second : nullptr;
+	}
+
+	const OpticalSlotClock::Slot*
+	OpticalSlotClock::Find(Time start) const
+	{
+		auto iter = m_calendar.find(start);
+		return (iter != m_calendar.end()) ? &iter->second : nullptr;
+	}
+
+	OpticalSlotClock::Slot&
+	OpticalSlotClock::Materialise(Time start)
+	{
+		auto iter = m_calendar.find(start);
+		if (iter != m_calendar.end())
+		{
+			return iter->second;
+		}
+		NS_LOG_LOGIC("Materialise slot " << start);
+		if (m_spare.empty())
+		{
+			iter = m_calendar.emplace(start, Slot()).first;
+		}
+		else
+		{
+			// Reuse an expired slot and its storage
+			auto node = std::move(m_spare.back());
+			m_spare.pop_back();
+			node.key() = start;
+			iter = m_calendar.insert(std::move(node)).position;
+		}
+		Slot& slot = iter->second;
+		slot.Reset(m_ports, m_channels);
+		for (uint32_t port = 0; port < m_fluid.size(); port++)
+		{
+			for (uint32_t ch = 0; ch < m_fluid[port].size(); ch++)
+			{
+				slot.SetBackground(port, ch, (m_timeslot_duration * 
+					m_fluid[port][ch]).GetTimeStep());
+			}
+		}
+		return slot;
+	}
+
+	void
+	OpticalSlotClock::Expire(Time now)
+	{
+		if (!m_slotted)
+		{
+			// Bursts that have passed are dropped on every lane
+			m_ended.clear();
+			for (uint32_t port = 0; port < m_bursts.GetNPorts(); port++)
+			{
+				for (uint32_t ch = 0; ch < m_bursts.GetWidth(); ch++)
+				{
+					m_bursts.RemoveEnded(port, ch, now.GetTimeStep(), 
+										 m_ended);
+				}
+			}
+			for (uint32_t ended : m_ended)
+			{
+				DropBurst(ended);
+			}
+			return;
+		}
+		Time current = GetSlotStart(GetCurrentSlot(now));
+		while (!m_calendar.empty() && m_calendar.begin()->first < current)
+		{
+			m_spare.push_back(m_calendar.extract(m_calendar.begin()));
+		}
+	}
+
+	void
+	OpticalSlotClock::Release(Time now, uint32_t port, uint8_t channel,
+							  uint32_t id)
+	{
+		if (!m_slotted)
+		{
+			m_bursts.RemoveBurst(port, channel, id);
+			DropBurst(id);
+			return;
+		}
+		Slot* slot = Find(GetSlotStart(GetCurrentSlot(now)));
+		if (!slot)
+		{
+			return;
+		}
+		slot->RemoveBurst(port, channel, id);
+	}
+
+	bool
+	OpticalSlotClock::Cancel(Time arrival, uint32_t ingress, uint32_t egress,
+							 uint8_t channel, uint32_t id)
+	{
+		Slot* slot = m_slotted ? Find(GetSlotStart(GetSlotIndex(arrival))) : 
+			&m_bursts;
+		if (!slot || ingress >= slot->GetNPorts() || 
+			egress >= slot->GetNPorts() || channel >= slot->GetWidth())
+		{
+			return false;
+		}
+		bool held = slot->RemoveBurst(ingress, channel, id);
+		slot->RemoveBurst(egress, channel, id);
+		if (!m_slotted)
+		{
+			DropBurst(id);
+		}
+		else if (held && slot->GetNBursts(ingress, channel) == 0)
+		{
+			slot->SetRoute(ingress, channel, -1);
+		}
+		return held;
+	}
+
+	int
+	OpticalSlotClock::GetIngress(Time arrival, uint32_t egress, 
+								 uint8_t channel, uint32_t id) const
+	{
+		if (!m_slotted)
+		{
+			auto iter = m_burst_routes.find(id);
+			if (iter == m_burst_routes.end() || iter->second.egress != egress)
+			{
+				return -1;
+			}
+			return iter->second.ingress;
+		}
+		const Slot* slot = Find(GetSlotStart(GetSlotIndex(arrival)));
+		if (!slot || egress >= slot->GetNPorts() || 
+			channel >= slot->GetWidth())
+		{
+			return -1;
+		}
+		for (uint32_t port = 0; port < slot->GetNPorts(); port++)
+		{
+			if (port != egress && 
+				slot->GetRoute(port, channel) == static_cast<int>(egress) &&
+				slot->HasBurst(port, channel, id))
+			{
+				return port;
+			}
+		}
+		return -1;
+	}
+
+	bool
+	OpticalSlotClock::Conflicts(Time arrival, Time exit, uint32_t port,
+								uint8_t channel, uint32_t id) const
+	{
+		const Slot* slot = m_slotted ? 
+			Find(GetSlotStart(GetSlotIndex(arrival))) : &m_bursts;
+		if (!slot || port >= slot->GetNPorts() || channel >= slot->GetWidth())
+		{
+			return false;
+		}
+		return slot->Overlaps(port, channel, arrival.GetTimeStep(), 
+							  exit.GetTimeStep(), id);
+	}
+
+	void
+	OpticalSlotClock::SetFluidLoad(uint32_t port, uint8_t channel, double load)
+	{
+		NS_LOG_FUNCTION(this << port << (int)channel << load);
+		NS_ASSERT_MSG(port < m_ports && channel <= m_channels,
+					  "Port or channel out of range.");
+		NS_ASSERT_MSG(load >= 0 && load <= 1, "Load must be in [0-1].");
+		if (m_fluid.empty())
+		{
+			m_fluid.assign(m_ports, std::vector<double>(m_channels + 1, 0));
+		}
+		m_fluid[port][channel] = load;
+	}
+
+	double
+	OpticalSlotClock::GetFluidLoad(uint32_t port, uint8_t channel) const
+	{
+		if (port >= m_fluid.size() || channel >= m_fluid[port].size())
+		{
+			return 0;
+		}
+		return m_fluid[port][channel];
+	}
+
+	bool
+	OpticalSlotClock::HasCapacity(const Slot& slot, uint32_t port, 
+								  uint8_t channel, Time tx_delay) const
+	{
+		// Reserved bursts never overlap, so they always leave room for
+		// one more that passed the overlap checks
+		int64_t background = slot.GetBackground(port, channel);
+		if (background <= 0)
+		{
+			return true;
+		}
+		int64_t used = background + tx_delay.GetTimeStep() + 
+			slot.GetBusyTime(port, channel);
+		return used <= m_timeslot_duration.GetTimeStep();
+	}
+
+	bool
+	OpticalSlotClock::HasCapacity(uint32_t port, uint8_t channel, 
+								  Time tx_delay) const
+	{
+		int64_t background = 
+			(m_timeslot_duration * GetFluidLoad(port, channel)).GetTimeStep();
+		if (background <= 0)
+		{
+			return true;
+		}
+		return background + tx_delay.GetTimeStep() <= 
+			m_timeslot_duration.GetTimeStep();
+	}
+
+	bool
+	OpticalSlotClock::Reserve(Time hold, Time exit, uint32_t ingress, 
+							  uint32_t egress, uint8_t channel, uint32_t id,
+							  Time now)
+	{
+		NS_ASSERT_MSG(!m_slotted, "Slotted clocks reserve in the calendar.");
+		if (ingress >= m_bursts.GetNPorts() || 
+			egress >= m_bursts.GetNPorts() || channel >= m_bursts.GetWidth())
+		{
+			return false;
+		}
+		Expire(now);
+		int64_t a2 = hold.GetTimeStep();
+		int64_t e2 = exit.GetTimeStep();
+		if (m_bursts.Overlaps(ingress, channel, a2, e2) ||
+			m_bursts.Overlaps(egress, channel, a2, e2))
+		{
+			return false;
+		}
+		m_bursts.AddBurst(ingress, channel, id, a2, e2);
+		m_bursts.AddBurst(egress, channel, id, a2, e2);
+		m_burst_routes[id] = {ingress, egress};
+		return true;
+	}
+
+	int
+	OpticalSlotClock::GetBurstRoute(uint32_t port, uint8_t channel, 
+									Time now) const
+	{
+		if (port >= m_bursts.GetNPorts() || channel >= m_bursts.GetWidth())
+		{
+			return -1;
+		}
+		uint32_t id = m_bursts.GetBurstAt(port, channel, now.GetTimeStep());
+		auto iter = m_burst_routes.find(id);
+		if (iter == m_burst_routes.end() || iter->second.ingress != port)
+		{
+			return -1;
+		}
+		return iter->second.egress;
+	}
+
+	void
+	OpticalSlotClock::DropBurst(uint32_t id)
+	{
+		m_burst_routes.erase(id);
+	}
+
+	const std::map<Time, OpticalSlotClock::Slot>&
+	OpticalSlotClock::GetCalendar() const
+	{
+		return m_calendar;
+	}
+
+	const OpticalSlotClock::Slot&
+	OpticalSlotClock::GetBursts() const
+	{
+		return m_bursts;
+	}
+
+	MemoryUsage
+	OpticalSlotClock::GetMemoryUsage() const
+	{
+		MemoryUsage usage;
+		uint64_t calendar = memory::MapBytes(m_calendar);
+		for (const auto& item : m_calendar)
+		{
+			calendar += item.second.GetMemoryBytes();
+		}
+		usage.push_back({"m_calendar", calendar});
+		uint64_t spare = memory::VectorBytes(m_spare) + m_spare.size() * 
+			(sizeof(std::pair<const Time, Slot>) + memory::TREE_NODE_OVERHEAD);
+		for (const auto& node : m_spare)
+		{
+			spare += node.mapped().GetMemoryBytes();
+		}
+		usage.push_back({"m_spare", spare});
+		uint64_t fluid = memory::VectorBytes(m_fluid);
+		for (const auto& port : m_fluid)
+		{
+			fluid += memory::VectorBytes(port);
+		}
+		usage.push_back({"m_fluid", fluid});
+		usage.push_back({"m_bursts", m_bursts.GetMemoryBytes() + 
+			memory::MapBytes(m_burst_routes) + memory::VectorBytes(m_ended)});
+		return usage;
+	}
+
+	uint64_t
+	OpticalSlotClock::GetMemoryFootprint() const
+	{
+		return memory::TotalBytes(GetMemoryUsage());
+	}
+}
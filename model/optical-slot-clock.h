@@ -0,0 +1,296 @@
+#ifndef OPTICAL_SLOT_CLOCK_H
+#define OPTICAL_SLOT_CLOCK_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/optical-memory.h"
+
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+	/**
+	 * @ingroup quantum-network
+	 * @class OpticalSlotClock
+	 * @brief Timeslot schedule shared by every optical port of a node.
+	 *
+	 * Slot k starts at epoch + k * (ReconfigureTime + TimeslotDuration) on
+	 * the node's local clock and is preceded by its reconfiguration window.
+	 * The clock is aggregated to the node and holds one calendar for all of
+	 * its ports: a slot binds each ingress port and channel to an egress
+	 * port and lists the bursts reserved through every port. Slots are
+	 * created on first use and dropped once they have passed, so the clock
+	 * schedules no events. Start allocates ScheduleSize + 1 slots up front,
+	 * dropped slots are kept and reused, so a calendar that stays within
+	 * the schedule never allocates. A clock that is not slotted keeps
+	 * every burst in one open ended table instead, each holding its ports
+	 * for its own interval.
+	 */
+	class OpticalSlotClock : public Object
+	{
+		public:
+			/**
+			 * Routes and reservations of one slot as flat arrays. A lane is
+			 * one port and channel, lane = port * (channels + 1) + channel.
+			 * The bursts of a lane sit in contiguous id, arrival and exit
+			 * arrays starting at lane * capacity, times in time steps, so
+			 * an overlap check is one branch free pass over the lane.
+			 */
+			class Slot
+			{
+				public:
+					static constexpr uint32_t NO_ID = 
+						static_cast<uint32_t>(-1);
+
+					Slot();
+					/**
+					 * @brief Unbind every route and drop every burst,
+					 * keeping the storage when the size is unchanged.
+					 * @param ports the number of ports.
+					 * @param channels the number of channels per port.
+					 */
+					void Reset(uint32_t ports, uint8_t channels);
+					uint32_t GetNPorts() const;
+					uint32_t GetWidth() const;
+
+					// Egress port or -1 if unbound
+					int GetRoute(uint32_t port, uint8_t channel) const;
+					void SetRoute(uint32_t port, uint8_t channel, int egress);
+
+					uint32_t GetNBursts(uint32_t port, uint8_t channel) const;
+					/**
+					 * @brief Whether [arrival, exit] touches a burst
+					 * reserved on the lane.
+					 * @param port the port.
+					 * @param channel the channel.
+					 * @param arrival the first time step of the burst.
+					 * @param exit the last time step of the burst.
+					 * @param except a message whose bursts are ignored.
+					 * @return True if the bursts overlap.
+					 */
+					bool Overlaps(uint32_t port, uint8_t channel, 
+								  int64_t arrival, int64_t exit,
+								  uint32_t except = NO_ID) const;
+					/**
+					 * @brief The channels of a port with no burst touching
+					 * [arrival, exit]. The lanes of a port are adjacent, so
+					 * this is one pass over a contiguous block.
+					 * @param port the port.
+					 * @param arrival the first time step of the burst.
+					 * @param exit the last time step of the burst.
+					 * @return A mask with bit c set if channel c is free,
+					 * bit 0 (control) is never set.
+					 */
+					uint64_t GetFreeChannels(uint32_t port, int64_t arrival,
+											 int64_t exit) const;
+					bool HasBurst(uint32_t port, uint8_t channel, 
+								  uint32_t id) const;
+					// The burst held on the lane at time step t, or NO_ID
+					uint32_t GetBurstAt(uint32_t port, uint8_t channel, 
+										int64_t t) const;
+					void AddBurst(uint32_t port, uint8_t channel, uint32_t id,
+								  int64_t arrival, int64_t exit);
+					bool RemoveBurst(uint32_t port, uint8_t channel, 
+									 uint32_t id);
+					// Drop the bursts that ended before a time step,
+					// appending their ids to ended
+					void RemoveEnded(uint32_t port, uint8_t channel, 
+									 int64_t before, 
+									 std::vector<uint32_t>& ended);
+					// Time steps held by the bursts of the lane
+					int64_t GetBusyTime(uint32_t port, uint8_t channel) const;
+
+					// Time steps held by fluid background load
+					int64_t GetBackground(uint32_t port, 
+										  uint8_t channel) const;
+					void SetBackground(uint32_t port, uint8_t channel,
+									   int64_t steps);
+
+					uint64_t GetMemoryBytes() const;
+				private:
+					void Grow();
+					bool LaneOverlaps(size_t lane, int64_t arrival,
+									  int64_t exit, uint32_t except) const;
+
+					uint32_t m_ports;
+					uint32_t m_width;
+					uint32_t m_capacity;
+					std::vector<int> m_routes;
+					std::vector<int64_t> m_background;
+					std::vector<uint32_t> m_count;
+					std::vector<uint32_t> m_ids;
+					std::vector<int64_t> m_arrival;
+					std::vector<int64_t> m_exit;
+			};
+
+			static TypeId GetTypeId();
+			OpticalSlotClock();
+			~OpticalSlotClock() override;
+
+			/**
+			 * @brief Register a port, every port of a node must use the same
+			 * slot timing. Slots and the burst table are sized for the
+			 * most ports and channels of every call.
+			 * @param reconfigure_time the reconfiguration window before a slot.
+			 * @param timeslot_duration the usable part of a slot.
+			 * @param schedule_size the slots ahead that accept reservations.
+			 * @param ports the number of devices on the node.
+			 * @param channels the number of channels on the port.
+			 */
+			void Configure(Time reconfigure_time, Time timeslot_duration,
+						   uint16_t schedule_size, uint32_t ports,
+						   uint8_t channels);
+			/**
+			 * @brief Set the epoch so the first slot starts after one
+			 * reconfiguration window, clear the calendar and allocate the
+			 * slots of one schedule.
+			 * @param now the local time of the node.
+			 */
+			void Start(Time now);
+			/**
+			 * @brief Choose between the slot calendar and one open ended
+			 * burst table, call before Start.
+			 * @param slotted false to reserve each burst for its own
+			 * interval, without slots.
+			 */
+			void SetSlotted(bool slotted);
+			bool IsSlotted() const;
+
+			int64_t GetSlotIndex(Time t) const;
+			Time GetSlotStart(int64_t index) const;
+			/**
+			 * @brief The slot whose reconfiguration has begun at local time
+			 * now, the first slot that accepts reservations.
+			 * @param now the local time of the node.
+			 * @return The index of the current slot.
+			 */
+			int64_t GetCurrentSlot(Time now) const;
+			bool IsReconfiguring(Time now) const;
+			bool IsInSchedule(Time now, int64_t index) const;
+			uint16_t GetScheduleSize() const;
+
+			Slot* Find(Time start);
+			const Slot* Find(Time start) const;
+			Slot& Materialise(Time start);
+			// Drop the slots, or the unslotted bursts, that have passed
+			void Expire(Time now);
+			void Release(Time now, uint32_t port, uint8_t channel,
+						 uint32_t id);
+			/**
+			 * @brief Withdraw a reservation refused further along its path.
+			 * The ingress channel is unbound once no burst of the slot is
+			 * left on it.
+			 * @param arrival the local time the burst would reach the node.
+			 * @param ingress the ifindex the burst would enter through.
+			 * @param egress the ifindex the burst would leave through.
+			 * @param channel the wavelength of the burst.
+			 * @param id the message of the burst.
+			 * @return True if the node held the reservation.
+			 */
+			bool Cancel(Time arrival, uint32_t ingress, uint32_t egress,
+						uint8_t channel, uint32_t id);
+			/**
+			 * @brief The port a reservation entered through, so a release
+			 * can retrace the path of its burst.
+			 * @param arrival the local time the burst would reach the node.
+			 * @param egress the ifindex the burst would leave through.
+			 * @param channel the wavelength of the burst.
+			 * @param id the message of the burst.
+			 * @return The ingress ifindex or -1 if the node holds no such
+			 * reservation.
+			 */
+			int GetIngress(Time arrival, uint32_t egress, uint8_t channel,
+						   uint32_t id) const;
+			/**
+			 * @brief Whether a burst crossing a port would overlap a burst
+			 * reserved by another message.
+			 * @param arrival the local time the burst reaches the port.
+			 * @param exit the local time the burst has passed the port.
+			 * @param port the ifindex of the port.
+			 * @param channel the wavelength of the burst.
+			 * @param id the message of the burst, its own reservation is
+			 * ignored.
+			 * @return True if the bursts would collide.
+			 */
+			bool Conflicts(Time arrival, Time exit, uint32_t port,
+						   uint8_t channel, uint32_t id) const;
+			/**
+			 * @brief Hold a fraction of every later slot of a port and
+			 * channel for fluid background traffic. Slots already in the
+			 * calendar keep the load they were created with.
+			 * @param port the ifindex of the port.
+			 * @param channel the wavelength.
+			 * @param load the fraction [0-1] of the slot.
+			 */
+			void SetFluidLoad(uint32_t port, uint8_t channel, double load);
+			double GetFluidLoad(uint32_t port, uint8_t channel) const;
+			/**
+			 * @brief Whether a burst fits next to the bursts and the
+			 * background load already held on a port of a slot.
+			 * @param slot the slot.
+			 * @param port the ifindex of the port.
+			 * @param channel the wavelength.
+			 * @param tx_delay the duration of the burst.
+			 * @return True if the slot has room for the burst.
+			 */
+			bool HasCapacity(const Slot& slot, uint32_t port, uint8_t channel,
+							 Time tx_delay) const;
+			// The same for a slot that holds no bursts yet
+			bool HasCapacity(uint32_t port, uint8_t channel, 
+							 Time tx_delay) const;
+			/**
+			 * @brief Reserve a burst in the burst table of a clock that is
+			 * not slotted.
+			 * @param hold the local time the ports are held from.
+			 * @param exit the local time the burst has passed.
+			 * @param ingress the ifindex the burst enters through.
+			 * @param egress the ifindex the burst leaves through.
+			 * @param channel the wavelength of the burst.
+			 * @param id the message of the burst.
+			 * @param now the local time of the node.
+			 * @return True if neither port is held in [hold, exit].
+			 */
+			bool Reserve(Time hold, Time exit, uint32_t ingress, 
+						 uint32_t egress, uint8_t channel, uint32_t id,
+						 Time now);
+			/**
+			 * @brief The egress of the burst entering a port at local time
+			 * now, for a clock that is not slotted.
+			 * @return The egress ifindex or -1.
+			 */
+			int GetBurstRoute(uint32_t port, uint8_t channel, 
+							  Time now) const;
+			const std::map<Time, Slot>& GetCalendar() const;
+			const Slot& GetBursts() const;
+
+			MemoryUsage GetMemoryUsage() const;
+			uint64_t GetMemoryFootprint() const;
+		private:
+			void DropBurst(uint32_t id);
+
+			Time m_epoch;
+			Time m_reconfigure_time;
+			Time m_timeslot_duration;
+			uint16_t m_schedule_size;
+			uint32_t m_ports;
+			uint8_t m_channels;
+			std::map<Time, Slot> m_calendar;
+			bool m_slotted;
+			// Expired slots kept to be materialised again
+			std::vector<std::map<Time, Slot>::node_type> m_spare;
+			// [port][channel] fluid load, empty until a load is set
+			std::vector<std::vector<double>> m_fluid;
+			struct BurstRoute
+			{
+				uint32_t ingress;
+				uint32_t egress;
+			};
+			// Reservations of a clock that is not slotted
+			Slot m_bursts;
+			memory::PoolMap<uint32_t, BurstRoute> m_burst_routes;
+			std::vector<uint32_t> m_ended;
+	};
+}
+
+#endif
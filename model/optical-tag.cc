@@ -40,7 +40,8 @@ namespace ns3
 	uint32_t
 	OpticalTag::GetSerializedSize() const
 	{
-		return 6;
+		// The destination is only carried on shared channels
+		return m_dest.IsBroadcast() ? 6 : 12;
 	}
 
 	void
@@ -48,7 +49,14 @@ namespace ns3
 	{
 		i.WriteU8(m_channel);
 		i.WriteU32(m_msg_id);
-		i.WriteU8(m_dropped);
+		bool addressed = !m_dest.IsBroadcast();
+		i.WriteU8(m_dropped | (addressed ? ADDRESSED : 0));
+		if (addressed)
+		{
+			uint8_t dest[6];
+			m_dest.CopyTo(dest);
+			i.Write(dest, 6);
+		}
 	}
 
 	void
@@ -56,14 +64,22 @@ namespace ns3
 	{
 		m_channel = i.ReadU8();
 		m_msg_id = i.ReadU32();
-		m_dropped = i.ReadU8();
+		uint8_t flags = i.ReadU8();
+		m_dropped = flags & ~ADDRESSED;
+		m_dest = Mac48Address::GetBroadcast();
+		if (flags & ADDRESSED)
+		{
+			uint8_t dest[6];
+			i.Read(dest, 6);
+			m_dest.CopyFrom(dest);
+		}
 	}
 
 	void
 	OpticalTag::Print(std::ostream& os) const
 	{
 		os << "Channel: " << m_channel << ", ID: " << m_msg_id << 
-			", Dropped: " << m_dropped;
+			", Dropped: " << m_dropped << ", Destination: " << m_dest;
 	}
 
 	void
@@ -90,6 +106,18 @@ namespace ns3
 		return m_msg_id;
 	}
 
+	void
+	OpticalTag::SetDestination(Mac48Address dest)
+	{
+		m_dest = dest;
+	}
+
+	Mac48Address
+	OpticalTag::GetDestination() const
+	{
+		return m_dest;
+	}
+
 	void
 	OpticalTag::DropPacket()
 	{
@@ -1,6 +1,7 @@
 #ifndef OPTICAL_TAG_H
 #define OPTICAL_TAG_H
 
+#include "ns3/mac48-address.h"
 #include "ns3/tag.h"
 
 namespace ns3
@@ -25,12 +26,18 @@ namespace ns3
 			void SetMsgId(uint32_t id);
 			uint8_t GetChannel() const;
 			uint32_t GetMsgId() const;
+			// The port addressed on a shared channel, broadcast if unknown
+			void SetDestination(Mac48Address dest);
+			Mac48Address GetDestination() const;
 			void DropPacket();
 			bool IsDropped();
 		private:
+			// Set in the serialized dropped byte when a destination follows
+			static const uint8_t ADDRESSED = 0x80;
 			uint8_t m_channel;
 			uint32_t m_msg_id;
 			uint8_t m_dropped = 0;
+			Mac48Address m_dest = Mac48Address::GetBroadcast();
 	};
 }
 
@@ -0,0 +1,160 @@
+#include "ns3/optical-telemetry.h"
+#include "ns3/optical-device.h"
+#include "ns3/quantum-application.h"
+
+#include "ns3/log.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+
+namespace ns3
+{
+	NS_LOG_COMPONENT_DEFINE("OpticalTelemetry");
+	NS_OBJECT_ENSURE_REGISTERED(OpticalTelemetry);
+
+	TypeId
+	OpticalTelemetry::GetTypeId()
+	{
+		static TypeId tid = 
+			TypeId("ns3::OpticalTelemetry")
+				.SetParent<Object>()
+				.SetGroupName("QuantumNetwork")
+				.AddConstructor<OpticalTelemetry>()
+				.AddAttribute("Interval",
+							  "Simulated time between samples.",
+							  TimeValue(MilliSeconds(1)),
+							  MakeTimeAccessor(&OpticalTelemetry::m_interval),
+							  MakeTimeChecker())
+				.AddAttribute("FileName",
+							  "The file the time series is written to.",
+							  StringValue("telemetry.csv"),
+							  MakeStringAccessor(
+							  	&OpticalTelemetry::m_file_name),
+							  MakeStringChecker());
+		return tid;
+	}
+
+	OpticalTelemetry::OpticalTelemetry()
+	{
+		NS_LOG_FUNCTION(this);
+	}
+
+	OpticalTelemetry::~OpticalTelemetry()
+	{
+		NS_LOG_FUNCTION(this);
+	}
+
+	void
+	OpticalTelemetry::DoDispose()
+	{
+		NS_LOG_FUNCTION(this);
+		Stop();
+		Object::DoDispose();
+	}
+
+	void
+	OpticalTelemetry::Start(Time start)
+	{
+		NS_LOG_FUNCTION(this << start);
+		NS_ASSERT_MSG(m_interval.IsStrictlyPositive(), 
+					  "Telemetry interval must be positive.");
+		if (!m_file.is_open())
+		{
+			Open();
+		}
+		Simulator::Cancel(m_sample_event);
+		m_sample_event = 
+			Simulator::Schedule(start - Simulator::Now(), 
+								&OpticalTelemetry::Sample, this);
+	}
+
+	void
+	OpticalTelemetry::Flush()
+	{
+		NS_LOG_FUNCTION(this);
+		if (m_file.is_open())
+		{
+			m_file.flush();
+		}
+	}
+
+	void
+	OpticalTelemetry::Reopen(std::string file_name)
+	{
+		NS_LOG_FUNCTION(this << file_name);
+		if (m_file.is_open())
+		{
+			m_file.close();
+		}
+		m_file_name = file_name;
+		Open();
+	}
+
+	void
+	OpticalTelemetry::Open()
+	{
+		NS_LOG_FUNCTION(this);
+		m_file.open(m_file_name);
+		NS_ASSERT_MSG(m_file.is_open(), "Could not open " << m_file_name);
+		m_file << "D,time_s,node,ifindex,ctrl_queue,reservations,"
+			   << "peak_channel,in_flight,nacks_per_s" << std::endl;
+		m_file << "A,time_s,node,app,qubits_used,num_qubits,tx_queue,"
+			   << "rx_queue,nacks_per_s" << std::endl;
+	}
+
+	void
+	OpticalTelemetry::Stop()
+	{
+		NS_LOG_FUNCTION(this);
+		Simulator::Cancel(m_sample_event);
+		if (m_file.is_open())
+		{
+			m_file.close();
+		}
+	}
+
+	void
+	OpticalTelemetry::Sample()
+	{
+		NS_LOG_FUNCTION(this);
+		double now = Simulator::Now().GetSeconds();
+		double interval = m_interval.GetSeconds();
+		for (auto n = NodeList::Begin(); n != NodeList::End(); n++)
+		{
+			Ptr<Node> node = *n;
+			uint32_t node_id = node->GetId();
+			for (uint32_t i = 0; i < node->GetNDevices(); i++)
+			{
+				Ptr<OpticalDevice> dev = 
+					DynamicCast<OpticalDevice>(node->GetDevice(i));
+				if (!dev) continue;
+				uint64_t nacks = dev->GetNackCount();
+				uint64_t& last = m_device_nacks[{node_id, i}];
+				m_file << "D," << now << "," << node_id << "," << i << ","
+					   << dev->GetControlQueueDepth() << ","
+					   << dev->GetReservationCount() << ","
+					   << dev->GetPeakChannelReservations() << ","
+					   << dev->GetInFlightCount() << ","
+					   << (nacks - last) / interval << "\n";
+				last = nacks;
+			}
+			for (uint32_t i = 0; i < node->GetNApplications(); i++)
+			{
+				Ptr<QuantumApplication> app = 
+					DynamicCast<QuantumApplication>(node->GetApplication(i));
+				if (!app) continue;
+				uint64_t nacks = app->GetNackCount();
+				uint64_t& last = m_app_nacks[{node_id, i}];
+				m_file << "A," << now << "," << node_id << "," << i << ","
+					   << app->GetQubitsInUse() << ","
+					   << app->GetNumQubits() << ","
+					   << app->GetTxQueueSize() << ","
+					   << app->GetRxQueueSize() << ","
+					   << (nacks - last) / interval << "\n";
+				last = nacks;
+			}
+		}
+		m_sample_event = 
+			Simulator::Schedule(m_interval, &OpticalTelemetry::Sample, this);
+	}
+}
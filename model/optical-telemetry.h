@@ -0,0 +1,59 @@
+#ifndef OPTICAL_TELEMETRY_H
+#define OPTICAL_TELEMETRY_H
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <fstream>
+#include <map>
+#include <string>
+
+namespace ns3
+{
+	/**
+	 * @ingroup quantum-network
+	 * @class OpticalTelemetry
+	 * @brief Periodic time-series sampler for optical devices and quantum
+	 * applications.
+	 *
+	 * Every Interval of simulated time one row is written per OpticalDevice
+	 * (D rows) and per QuantumApplication (A rows) found in the NodeList.
+	 * NACK rates are the NACKs counted since the previous sample divided by
+	 * the interval.
+	 */
+	class OpticalTelemetry : public Object
+	{
+		public:
+			static TypeId GetTypeId();
+			OpticalTelemetry();
+			~OpticalTelemetry() override;
+			/**
+			 * @brief Open the output file and take the first sample.
+			 * @param start the simulation time of the first sample.
+			 */
+			void Start(Time start);
+			void Stop();
+			// Write out the buffered rows, before the process forks
+			void Flush();
+			/**
+			 * @brief Write the following samples to another file, which
+			 * starts with its own header.
+			 * @param file_name the new output file.
+			 */
+			void Reopen(std::string file_name);
+		private:
+			void DoDispose() override;
+			void Open();
+			void Sample();
+
+			Time m_interval;
+			std::string m_file_name;
+			std::ofstream m_file;
+			EventId m_sample_event;
+			std::map<std::pair<uint32_t, uint32_t>, uint64_t> m_device_nacks;
+			std::map<std::pair<uint32_t, uint32_t>, uint64_t> m_app_nacks;
+	};
+}
+
+#endif
@@ -3,7 +3,9 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include "ns3/udp-socket.h"
+#include "ns3/optical-byte-codec.h"
 #include "ns3/optical-device.h"
+#include "ns3/optical-profiler.h"
 
 #include <algorithm>
 #include <string>
@@ -102,7 +104,14 @@ namespace ns3
 						  TimeValue(NanoSeconds(1400)),
 						  MakeTimeAccessor(
 						  	&QuantumApplication::m_measurement_time),
-						  MakeTimeChecker());
+						  MakeTimeChecker())
+			.AddAttribute("MemoryFootprint",
+						  "Estimated heap bytes held by the application.",
+						  TypeId::ATTR_GET,
+						  UintegerValue(0),
+						  MakeUintegerAccessor(
+						  	&QuantumApplication::GetMemoryFootprint),
+						  MakeUintegerChecker<uint64_t>());
 		return tid;
 	}
 
@@ -144,6 +153,63 @@ namespace ns3
 		}
 	}
 
+	MemoryUsage
+	QuantumApplication::GetMemoryUsage() const
+	{
+		MemoryUsage usage;
+		usage.push_back({"m_peers", memory::VectorBytes(m_peers)});
+		usage.push_back({"m_data", memory::MapBytes(m_data)});
+		usage.push_back({"m_rx_queue", memory::VectorBytes(m_rx_queue)});
+		usage.push_back({"m_tx_queue", memory::VectorBytes(m_tx_queue)});
+		usage.push_back({"m_rx_qubits", memory::VectorBytes(m_rx_qubits)});
+		usage.push_back({"m_tx_qubits", memory::VectorBytes(m_tx_qubits)});
+		usage.push_back({"m_classic_storage",
+						 memory::VectorBytes(m_classic_storage)});
+		return usage;
+	}
+
+	uint64_t
+	QuantumApplication::GetMemoryFootprint() const
+	{
+		return memory::TotalBytes(GetMemoryUsage());
+	}
+
+	uint32_t
+	QuantumApplication::GetQubitsInUse() const
+	{
+		return m_rx_qubits.size() + m_tx_qubits.size();
+	}
+
+	uint16_t
+	QuantumApplication::GetNumQubits() const
+	{
+		return m_num_qubits;
+	}
+
+	uint32_t
+	QuantumApplication::GetTxQueueSize() const
+	{
+		return m_tx_queue.size();
+	}
+
+	uint32_t
+	QuantumApplication::GetRxQueueSize() const
+	{
+		return m_rx_queue.size();
+	}
+
+	uint64_t
+	QuantumApplication::GetNackCount() const
+	{
+		return m_nack_count;
+	}
+
+	uint64_t
+	QuantumApplication::GetDeliveredCount() const
+	{
+		return m_delivered_count;
+	}
+
 	void
 	QuantumApplication::StartApplication()
 	{
@@ -202,6 +268,8 @@ namespace ns3
 	void
 	QuantumApplication::DataReceiveCallback(Ptr<Socket> sock)
 	{
+		OpticalProfiler::Scope profile(OpticalProfiler::DATA_RECEIVE_CALLBACK,
+									   true);
 		Address from;
 		Ptr<Packet> packet;
 		int buff_size = m_buff_size > 64 ? m_buff_size : 64;
@@ -212,7 +280,7 @@ namespace ns3
 			read = read + packet->CopyData(&buffer[0], buff_size);
 		}
 		uint8_t msg_type = buffer[0];
-		uint32_t id = BytesToUint32(buffer, 1);
+		uint32_t id = codec::LoadUint32(buffer, 1);
 		uint8_t protocol = buffer[5];
 		NS_LOG_FUNCTION(m_id << id << msg_type);
 		Time current = Simulator::Now();
@@ -443,7 +511,7 @@ namespace ns3
 					Address addr = m_peers[item.peer];
 					uint8_t out_buffer[8];
 					out_buffer[0] = 1;
-					std::memcpy(&out_buffer[1], &(item.id), 4);
+					codec::StoreUint32(out_buffer, 1, item.id);
 					out_buffer[5] = item.protocol;
 					out_buffer[6] = item.x_result;
 					out_buffer[7] = item.z_result;
@@ -456,7 +524,7 @@ namespace ns3
 					Address peer = m_peers[item.peer];
 					uint8_t *out_buffer = new uint8_t[m_buff_size];
 					out_buffer[0] = 0;
-					std::memcpy(&out_buffer[1], &(item.id), 4);
+					codec::StoreUint32(out_buffer, 1, item.id);
 					out_buffer[5] = item.protocol;
 					m_sock->SendTo(out_buffer, m_buff_size , 0, peer);
 					delete[] out_buffer;
@@ -580,7 +648,7 @@ namespace ns3
 			Address addr = m_peers[item.peer];
 			uint8_t buffer[8];
 			buffer[0] = 1;
-			std::memcpy(&buffer[1], &(item.id), 4);
+			codec::StoreUint32(buffer, 1, item.id);
 			buffer[5] = item.protocol;
 			uint8_t x_result = 255;
 			uint8_t z_result = 255;
@@ -630,11 +698,16 @@ namespace ns3
 		Address addr = m_peers[peer];
 		uint8_t buffer[6];
 		buffer[0] = 2;
-		std::memcpy(&buffer[1], &(id), 4);
+		codec::StoreUint32(buffer, 1, id);
 		buffer[5] = protocol;
 		m_sock->SendTo(&buffer[0], 6 , 0, addr);
-		//NS_ASSERT_MSG(m_data.find(id) != m_data.end(), "NACK for unsaved packet.");
-		m_data[id].nacks++;
+		m_nack_count++;
+		// Do not create entries for ids that are not tracked, they never erase
+		auto iter = m_data.find(id);
+		if (iter != m_data.end())
+		{
+			iter->second.nacks++;
+		}
 		NS_LOG_DEBUG("NACK-ID: " << id);
 	}
 	
@@ -645,7 +718,7 @@ namespace ns3
 		Address addr = m_peers[peer];
 		uint8_t buffer[6];
 		buffer[0] = 3;
-		std::memcpy(&buffer[1], &(id), 4);
+		codec::StoreUint32(buffer, 1, id);
 		buffer[5] = protocol;
 		m_sock->SendTo(&buffer[0], 6 , 0, addr);
 		NS_ASSERT_MSG(m_data.find(id) != m_data.end(), "AWK for unsaved packet.");
@@ -680,6 +753,7 @@ namespace ns3
 		else
 		{
 			m_rx_qubits.erase(m_rx_qubits.begin() + index);
+			m_delivered_count++;
 			if (m_rx_queue.size() > 0)
 			{
 				item = m_rx_queue[0];
@@ -772,7 +846,7 @@ namespace ns3
 			Address peer = m_peers[item.peer];
 			uint8_t *buffer = new uint8_t[m_buff_size];
 			buffer[0] = 0;
-			std::memcpy(&buffer[1], &(item.id), 4);
+			codec::StoreUint32(buffer, 1, item.id);
 			buffer[5] = item.protocol;
 			m_sock->SendTo(buffer, m_buff_size , 0, peer);
 			delete[] buffer;
@@ -785,25 +859,5 @@ namespace ns3
 						 (int)m_rx_queue.size());
 			Send();
 		}
-	} 
-
-	uint32_t
-    QuantumApplication::BytesToUint32(uint8_t* buffer, int offset)
-  	{
-	  	NS_LOG_FUNCTION(m_id);
-	  	uint32_t low = static_cast<uint32_t>(BytesToUint16(buffer, offset));
-	  	uint32_t high = static_cast<uint32_t>(BytesToUint16(buffer, offset + 2));
-	  	uint32_t value = high << 16 | low;
-	  	return value;
-  	}
- 
-    uint16_t
-   	QuantumApplication::BytesToUint16(uint8_t* buffer, int offset)
-    {
-        NS_LOG_FUNCTION(m_id);
-        uint16_t low = static_cast<uint16_t>(buffer[offset]);
-        uint16_t high = static_cast<uint16_t>(buffer[offset + 1]);
-        uint16_t value = high << 8 | low;
-        return value;
-    }  
+	}
 } // namespace ns3
@@ -17,6 +17,7 @@
 #include "ns3/socket.h"
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
+#include "ns3/optical-memory.h"
 
 #include <vector>
 #include <map>
@@ -76,6 +77,34 @@ namespace ns3
 			 */
 			void AddPeer(const Address& addr);
 			void RemovePeer(const Address& ip);
+			/**
+			 * @brief Get the estimated heap bytes of each container.
+			 * @return The container names and their byte counts.
+			 */
+			MemoryUsage GetMemoryUsage() const;
+			/**
+			 * @brief Get the estimated heap bytes held by the application.
+			 * @return The total of GetMemoryUsage.
+			 */
+			uint64_t GetMemoryFootprint() const;
+			/**
+			 * @brief Get the number of qubits currently held by protocols.
+			 * @return The size of the rx and tx qubit lists.
+			 */
+			uint32_t GetQubitsInUse() const;
+			uint16_t GetNumQubits() const;
+			uint32_t GetTxQueueSize() const;
+			uint32_t GetRxQueueSize() const;
+			/**
+			 * @brief Get the number of NACKs sent by the application.
+			 * @return The NACK count since the application was created.
+			 */
+			uint64_t GetNackCount() const;
+			/**
+			 * @brief Get the number of qubits this application received.
+			 * @return The protocols completed as the receiver.
+			 */
+			uint64_t GetDeliveredCount() const;
 		protected:
 			uint16_t m_msg_count = 0;
 			uint16_t m_id;
@@ -84,6 +113,8 @@ namespace ns3
 			std::vector<Address> m_peers;
 		private:
 			std::map<uint32_t, DataItem> m_data;
+			uint64_t m_nack_count = 0;
+			uint64_t m_delivered_count = 0;
 
 			uint16_t m_max_tx_queue;
 			uint8_t m_tos;
@@ -93,8 +124,6 @@ namespace ns3
 			void DataReceiveCallback(Ptr<Socket> sock);
 			void Run();
 			void Send();
-			uint32_t BytesToUint32(uint8_t *buffer, int offset);
-			uint16_t BytesToUint16(uint8_t *buffer, int offest);
 			void ApplyConditional(uint32_t id, bool sender);
 			void SendClassical(uint32_t id, bool sender);
 			void SendNACK(uint32_t id, uint8_t protocol, int peer);
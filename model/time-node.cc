@@ -64,6 +64,13 @@ namespace ns3
 		return local;
 	}
 
+	Time
+	TimeNode::GetLocalTimeAfter(Time delay) const
+	{
+		Time elapsed = Simulator::Now() + delay - m_lastGlobal;
+		return m_lastLocal + elapsed + (elapsed * (m_skew / 1000000.0));
+	}
+
 	Time
 	TimeNode::GetGlobalTime() const
 	{
@@ -14,6 +14,13 @@ namespace ns3
 			TimeNode(uint32_t systemId);
 			~TimeNode() override;
 			Time GetLocalTime();
+			/**
+			 * @brief The local time once delay has passed on the global
+			 * clock, without advancing the node.
+			 * @param delay the global time from now.
+			 * @return The predicted local time.
+			 */
+			Time GetLocalTimeAfter(Time delay) const;
 			Time GetGlobalTime() const;
 			double GetSkew() const;
 			void SetLocalTime(Time time);
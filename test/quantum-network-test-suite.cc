@@ -7,7 +7,14 @@
 #include "ns3/packet.h"
 #include "ns3/optical-device.h"
 #include "ns3/optical-tag.h"
+#include "ns3/optical-header.h"
+#include "ns3/optical-byte-codec.h"
+#include "ns3/optical-channel.h"
+#include "ns3/optical-awgr.h"
 #include "ns3/optical-helper.h"
+#include "ns3/optical-slot-clock.h"
+#include "ns3/optical-address-helper.h"
+#include "ns3/fat-tree-helper.h"
 #include "ns3/data-rate.h"
 #include "ns3/nstime.h"
 #include "ns3/address.h"
@@ -17,7 +24,9 @@
 #include "ns3/ipv4-address.h"
 #include "ns3/udp-socket.h"
 
+#include <map>
 #include <string>
+#include <vector>
 
 using namespace ns3;
 
@@ -80,21 +89,8 @@ TimeNodeTests::DoRun()
 	Simulator::Destroy();
 }
 
-NodeContainer GetTestNetwork(int endpoints, uint8_t channels)
+OpticalHelper GetTestHelper(uint8_t channels)
 {
-	NodeContainer container;
-	NodeContainer ends;
-	for (int i = 0; i <= endpoints; i++)
-	{
-		Ptr<TimeNode> node = CreateObject<TimeNode>();
-		node->SetAttribute("Skew", DoubleValue(0));
-		container.Add(node);
-		if (i > 0)
-		{
-			ends.Add(node);
-		}
-	}
-	
 	OpticalHelper helper;
 	helper.SetDeviceAttribute("FailureRate", DoubleValue(0.0));
 	helper.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("5p"));
@@ -115,6 +111,25 @@ NodeContainer GetTestNetwork(int endpoints, uint8_t channels)
 	helper.SetDeviceAttribute("OpticalProcessing", TimeValue(NanoSeconds(350)));
 	helper.SetChannelAttribute("Delay", TimeValue(NanoSeconds(5)));
 	helper.SetChannelAttribute("NumChannels", UintegerValue(channels));
+	return helper;
+}
+
+NodeContainer GetTestNetwork(int endpoints, uint8_t channels)
+{
+	NodeContainer container;
+	NodeContainer ends;
+	for (int i = 0; i <= endpoints; i++)
+	{
+		Ptr<TimeNode> node = CreateObject<TimeNode>();
+		node->SetAttribute("Skew", DoubleValue(0));
+		container.Add(node);
+		if (i > 0)
+		{
+			ends.Add(node);
+		}
+	}
+	
+	OpticalHelper helper = GetTestHelper(channels);
 	
 	InternetStackHelper stack;
 	Ipv4AddressHelper address;
@@ -705,6 +720,1328 @@ OpticalDeviceRouteTest::DoRun()
 		"Transmission series did not arrive as expected.");
 }
 
+/**
+ * @ingroup quantum-network-tests
+ * Test case idle devices do not schedule timeslot events
+ */
+class OpticalDeviceIdleTest : public TestCase
+{
+  public:
+    OpticalDeviceIdleTest();
+    virtual ~OpticalDeviceIdleTest();
+  private:
+    void DoRun() override;
+};
+OpticalDeviceIdleTest::OpticalDeviceIdleTest()
+    : TestCase("Will test idle devices generate no timeslot events."){}
+OpticalDeviceIdleTest::~OpticalDeviceIdleTest(){}
+
+void
+OpticalDeviceIdleTest::DoRun()
+{
+	NodeContainer endpoints = GetTestNetwork(2, 1);
+	Simulator::Stop(MilliSeconds(1));
+	Simulator::Run();
+	// 1ms holds 95 timeslots of 10.5us, one event per slot is too many
+	NS_TEST_ASSERT_MSG_LT(Simulator::GetEventCount(), 95, 
+		"Idle devices scheduled timeslot events.");
+	Ptr<OpticalDevice> dev = 
+		DynamicCast<OpticalDevice>(endpoints.Get(0)->GetDevice(0));
+	NS_TEST_ASSERT_MSG_EQ(dev->GetReservationCount(), 0, 
+		"Idle device holds reservations.");
+	Ptr<OpticalSlotClock> clock = 
+		endpoints.Get(0)->GetObject<OpticalSlotClock>();
+	NS_TEST_ASSERT_MSG_NE(clock, nullptr, "Node has no slot clock.");
+	NS_TEST_ASSERT_MSG_EQ(clock->GetCalendar().size(), 0, 
+		"Idle clock materialised a timeslot.");
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for fast-forwarded data bursts
+ */
+class OpticalFastForwardTest : public TestCase
+{
+  public:
+    OpticalFastForwardTest();
+    virtual ~OpticalFastForwardTest();
+  private:
+    void DoRun() override;
+	void RxCallback(Ptr<Socket> sock);
+	void SendFunc();
+	Ptr<Socket> m_tx;
+	Address m_dest;
+	Time m_rx_time;
+};
+OpticalFastForwardTest::OpticalFastForwardTest()
+    : TestCase("Will test bursts reach the endpoint in one event."){}
+OpticalFastForwardTest::~OpticalFastForwardTest(){}
+
+void
+OpticalFastForwardTest::RxCallback(Ptr<Socket> sock)
+{
+	sock->Recv();
+	m_rx_time = Simulator::Now();
+}
+
+void
+OpticalFastForwardTest::SendFunc()
+{
+	std::string msg = "Hello from node.";
+	m_tx->SendTo(reinterpret_cast<const uint8_t*>(&msg[0]), 16, 0, m_dest);
+}
+
+void
+OpticalFastForwardTest::DoRun()
+{
+	Config::SetDefault("ns3::OpticalDevice::FastForward", BooleanValue(true));
+	NodeContainer endpoints = GetTestNetwork(2, 1);
+	TypeId sock_tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+	Ptr<Node> dest = endpoints.Get(1);
+	Ipv4Address addr = dest->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
+	m_dest = InetSocketAddress(addr, 80);
+	Ptr<Socket> rx = Socket::CreateSocket(dest, sock_tid);
+	rx->Bind(m_dest);
+	rx->SetRecvCallback(
+		MakeCallback(&OpticalFastForwardTest::RxCallback, this));
+	m_tx = Socket::CreateSocket(endpoints.Get(0), sock_tid);
+	Simulator::Schedule(NanoSeconds(10), &OpticalFastForwardTest::SendFunc,
+						this);
+	Simulator::Stop(NanoSeconds(20000));
+	Simulator::Run();
+	// Same arrival as the event path of OpticalDeviceRouteTest
+	NS_TEST_ASSERT_MSG_EQ(m_rx_time, NanoSeconds(1472), 
+		"Fast-forwarded burst arrived at the wrong time.");
+	m_tx = nullptr;
+	Simulator::Destroy();
+	Config::SetDefault("ns3::OpticalDevice::FastForward", BooleanValue(false));
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for timeslot boundaries
+ */
+class OpticalSlotClockTest : public TestCase
+{
+  public:
+    OpticalSlotClockTest();
+    virtual ~OpticalSlotClockTest();
+  private:
+    void DoRun() override;
+};
+OpticalSlotClockTest::OpticalSlotClockTest()
+    : TestCase("Will test slot arithmetic on slot edges."){}
+OpticalSlotClockTest::~OpticalSlotClockTest(){}
+
+void
+OpticalSlotClockTest::DoRun()
+{
+	Ptr<OpticalSlotClock> clock = CreateObject<OpticalSlotClock>();
+	clock->Configure(NanoSeconds(500), MicroSeconds(10), 5, 1, 1);
+	clock->Start(NanoSeconds(0));
+	// Slot k starts at 500 + 10500k, reconfiguring during the 500ns before
+	NS_TEST_ASSERT_MSG_EQ(clock->GetSlotStart(1), NanoSeconds(11000),
+		"Wrong slot start.");
+	NS_TEST_ASSERT_MSG_EQ(clock->GetSlotIndex(NanoSeconds(499)), -1,
+		"Time before the epoch is in slot -1.");
+	NS_TEST_ASSERT_MSG_EQ(clock->GetSlotIndex(NanoSeconds(500)), 0,
+		"The epoch starts slot 0.");
+	NS_TEST_ASSERT_MSG_EQ(clock->GetSlotIndex(NanoSeconds(10999)), 0,
+		"Last ns of slot 0.");
+	NS_TEST_ASSERT_MSG_EQ(clock->GetSlotIndex(NanoSeconds(11000)), 1,
+		"First ns of slot 1.");
+
+	NS_TEST_ASSERT_MSG_EQ(clock->IsReconfiguring(NanoSeconds(0)), true,
+		"Reconfiguring before the first slot.");
+	NS_TEST_ASSERT_MSG_EQ(clock->IsReconfiguring(NanoSeconds(500)), false,
+		"Slot 0 is usable at its start.");
+	NS_TEST_ASSERT_MSG_EQ(clock->IsReconfiguring(NanoSeconds(10499)), false,
+		"Slot 0 is usable until its end.");
+	NS_TEST_ASSERT_MSG_EQ(clock->IsReconfiguring(NanoSeconds(10500)), true,
+		"Slot 1 reconfigures after slot 0 ends.");
+	NS_TEST_ASSERT_MSG_EQ(clock->IsReconfiguring(NanoSeconds(10999)), true,
+		"Slot 1 reconfigures until it starts.");
+	NS_TEST_ASSERT_MSG_EQ(clock->IsReconfiguring(NanoSeconds(11000)), false,
+		"Slot 1 is usable at its start.");
+
+	NS_TEST_ASSERT_MSG_EQ(clock->GetCurrentSlot(NanoSeconds(10499)), 0,
+		"Slot 0 is current until slot 1 reconfigures.");
+	NS_TEST_ASSERT_MSG_EQ(clock->GetCurrentSlot(NanoSeconds(10500)), 1,
+		"Slot 1 is current once it reconfigures.");
+	NS_TEST_ASSERT_MSG_EQ(clock->IsInSchedule(NanoSeconds(10500), 5), true,
+		"Last slot of the schedule.");
+	NS_TEST_ASSERT_MSG_EQ(clock->IsInSchedule(NanoSeconds(10500), 6), false,
+		"Slot beyond the schedule.");
+	NS_TEST_ASSERT_MSG_EQ(clock->IsInSchedule(NanoSeconds(10500), 0), false,
+		"Slot already passed.");
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for the send time of a burst around reconfigurations
+ */
+class OpticalTransmitTimeTest : public TestCase
+{
+  public:
+    OpticalTransmitTimeTest();
+    virtual ~OpticalTransmitTimeTest();
+  private:
+    void DoRun() override;
+	Time GetLoopTransmitTime(Time current, Time tx_data);
+	Ptr<OpticalSlotClock> m_clock;
+	Time m_next;
+};
+OpticalTransmitTimeTest::OpticalTransmitTimeTest()
+    : TestCase("Will test burst send times against the slot walk."){}
+OpticalTransmitTimeTest::~OpticalTransmitTimeTest(){}
+
+// The walk over the schedule GetPacketTransmitTime did before the closed
+// form, with the timing of GetTestHelper and an empty control queue
+Time
+OpticalTransmitTimeTest::GetLoopTransmitTime(Time current, Time tx_data)
+{
+	int64_t first = m_clock->GetCurrentSlot(current);
+	if (m_next < m_clock->GetSlotStart(first))
+	{
+		m_next = m_clock->GetSlotStart(first);
+	}
+	Time estimate_send = current + NanoSeconds(350 + 738);
+	Time send_time = (estimate_send >= m_next) ? estimate_send : m_next;
+	Time total_time = send_time + tx_data + NanoSeconds(12);
+	for (int64_t t = first; t < first + 5; t++)
+	{
+		const Time timeslot = m_clock->GetSlotStart(t);
+		if ((total_time >= timeslot - NanoSeconds(500)) &&
+			(total_time < timeslot))
+		{
+			send_time = timeslot;
+			break;
+		}
+	}
+	m_next = send_time + tx_data + NanoSeconds(50 + 1);
+	return send_time;
+}
+
+void
+OpticalTransmitTimeTest::DoRun()
+{
+	NodeContainer nodes;
+	for (int i = 0; i < 2; i++)
+	{
+		Ptr<TimeNode> node = CreateObject<TimeNode>();
+		node->SetAttribute("Skew", DoubleValue(0));
+		nodes.Add(node);
+	}
+	OpticalHelper helper = GetTestHelper(1);
+	NetDeviceContainer devs = helper.Install(nodes.Get(0), nodes.Get(1));
+	NodeContainer ends(nodes.Get(0));
+	helper.SetEndpoints(ends);
+	helper.Initialize(nodes);
+	Ptr<OpticalDevice> dev = DynamicCast<OpticalDevice>(devs.Get(0));
+	Ptr<TimeNode> node = DynamicCast<TimeNode>(nodes.Get(0));
+	m_clock = dev->GetSlotClock();
+	m_next = m_clock->GetSlotStart(0);
+
+	Time tx_ctrl = NanoSeconds(14);
+	Time tx_data = NanoSeconds(30);
+	// Bursts ending just before, at the start, at the end and just after
+	// the reconfiguration of a slot. Each case starts 10 slots after the
+	// last so the previous burst does not hold it back.
+	int64_t before[] = {501, 500, 1, 0};
+	bool moved[] = {false, true, true, false};
+	for (int i = 0; i < 4; i++)
+	{
+		Time slot = m_clock->GetSlotStart(10 * (i + 1));
+		Time current = slot - NanoSeconds(before[i]) - tx_data - 
+			NanoSeconds(12 + 350 + 738);
+		node->SetLocalTime(current);
+		Time send = dev->GetPacketTransmitTime(tx_ctrl, tx_data, 1);
+		NS_TEST_ASSERT_MSG_EQ(send, GetLoopTransmitTime(current, tx_data),
+			"Send time differs from the slot walk.");
+		NS_TEST_ASSERT_MSG_EQ(send == slot, moved[i], 
+			"Wrong adjustment for a burst ending " << before[i] << 
+			"ns before a slot.");
+	}
+
+	// A burst queued behind the last one ends after the window
+	Time current = node->GetLocalTime();
+	Time send = dev->GetPacketTransmitTime(tx_ctrl, tx_data, 1);
+	NS_TEST_ASSERT_MSG_EQ(send, GetLoopTransmitTime(current, tx_data),
+		"Send time of a queued burst differs from the slot walk.");
+
+	// Long bursts ending in the window of the last slot of the schedule
+	// and of the first slot past it
+	int64_t last[] = {4, 5};
+	for (int i = 0; i < 2; i++)
+	{
+		current = m_clock->GetSlotStart(100 * (i + 1)) + NanoSeconds(100);
+		Time slot = m_clock->GetSlotStart(100 * (i + 1) + last[i]);
+		Time end = slot - NanoSeconds(200);
+		Time tx_long = end - current - NanoSeconds(12 + 350 + 738);
+		node->SetLocalTime(current);
+		send = dev->GetPacketTransmitTime(tx_ctrl, tx_long, 1);
+		NS_TEST_ASSERT_MSG_EQ(send, GetLoopTransmitTime(current, tx_long),
+			"Send time of a long burst differs from the slot walk.");
+		NS_TEST_ASSERT_MSG_EQ(send == slot, last[i] < 5,
+			"Only slots in the schedule move a burst.");
+	}
+	m_clock = nullptr;
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for the earliest-deadline-first control scheduler
+ */
+class OpticalEdfTest : public TestCase
+{
+  public:
+    OpticalEdfTest();
+    virtual ~OpticalEdfTest();
+  private:
+    void DoRun() override;
+	Ptr<Packet> CreateControl(uint32_t id, uint8_t msg_type, Time timestamp,
+							  uint32_t ifindex);
+	void QueueEndpoint();
+	void QueueSwitch();
+	void TxSink(Ptr<const Packet> p);
+	void RxSink(Ptr<const Packet> p);
+	Ptr<OpticalDevice> m_source;
+	Ptr<OpticalDevice> m_ingress;
+	Ptr<OpticalDevice> m_egress;
+	Ipv4Address m_from;
+	Ipv4Address m_to;
+	Time m_arrival;
+	std::vector<uint32_t> m_sent;
+	bool m_released;
+};
+OpticalEdfTest::OpticalEdfTest()
+    : TestCase("Will test control packets are sent by deadline."),
+	  m_released(false){}
+OpticalEdfTest::~OpticalEdfTest(){}
+
+Ptr<Packet>
+OpticalEdfTest::CreateControl(uint32_t id, uint8_t msg_type, Time timestamp,
+							  uint32_t ifindex)
+{
+	uint8_t buffer[26] = {};
+	buffer[0] = msg_type;
+	codec::StoreUint32(buffer, 1, id);
+	codec::StoreUint64(buffer, 5, timestamp.GetNanoSeconds());
+	codec::StoreUint64(buffer, 13, 30);
+	buffer[21] = 1;
+	codec::StoreUint32(buffer, 22, ifindex);
+	Ptr<Packet> p = Create<Packet>(buffer, 26);
+	UdpHeader udp_header;
+	p->AddHeader(udp_header);
+	Ipv4Header ipv4_header;
+	ipv4_header.SetSource(m_from);
+	ipv4_header.SetDestination(m_to);
+	ipv4_header.SetProtocol(UdpL4Protocol::PROT_NUMBER);
+	ipv4_header.SetTtl(64);
+	ipv4_header.SetPayloadSize(34);
+	p->AddHeader(ipv4_header);
+	return p;
+}
+
+void
+OpticalEdfTest::QueueEndpoint()
+{
+	// The first AWK leaves at once, the rest wait for it by deadline
+	Time now = Simulator::Now();
+	uint8_t types[] = {3, 2, 3, 1, 1, 1};
+	Time data[] = {Seconds(0), Seconds(0), Seconds(0), now + MicroSeconds(3),
+				   now + MicroSeconds(2), now + NanoSeconds(500)};
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		uint32_t id = i + 1;
+		Ptr<Packet> p = CreateControl(id, types[i], data[i], 
+									  m_source->GetIfIndex());
+		OpticalHeader header;
+		header.SetProtocol(0x0800);
+		header.SetTimestamp(now.GetNanoSeconds());
+		header.SetMsgId(id);
+		p->AddHeader(header);
+		OpticalTag tag;
+		tag.SetChannel(0);
+		tag.SetMsgId(id);
+		p->AddPacketTag(tag);
+		m_source->ControlSend(p, types[i], data[i]);
+	}
+}
+
+void
+OpticalEdfTest::QueueSwitch()
+{
+	// An admitted reservation queued behind an AWK past its deadline
+	Time now = Simulator::Now();
+	m_egress->Send(CreateControl(10, 3, now, m_ingress->GetIfIndex()),
+				   m_egress->GetRemote(), 0x0800);
+	Time sent = now + NanoSeconds(600);
+	m_arrival = sent + NanoSeconds(5);
+	m_egress->Send(CreateControl(11, 1, sent, m_ingress->GetIfIndex()),
+				   m_egress->GetRemote(), 0x0800);
+	NS_TEST_ASSERT_MSG_EQ(m_egress->GetSlotOccupancy(m_arrival, 1), 1,
+		"The switch did not hold the burst.");
+}
+
+void
+OpticalEdfTest::TxSink(Ptr<const Packet> p)
+{
+	OpticalTag tag;
+	p->PeekPacketTag(tag);
+	m_sent.push_back(tag.GetMsgId());
+}
+
+void
+OpticalEdfTest::RxSink(Ptr<const Packet> p)
+{
+	Ptr<Packet> copy = p->Copy();
+	OpticalHeader header;
+	copy->RemoveHeader(header);
+	Ipv4Header ipv4_header;
+	UdpHeader udp_header;
+	copy->RemoveHeader(ipv4_header);
+	copy->RemoveHeader(udp_header);
+	uint8_t buffer[26];
+	copy->CopyData(buffer, sizeof(buffer));
+	if (buffer[0] == 4 && codec::LoadUint32(buffer, 1) == 11)
+	{
+		m_released = true;
+	}
+}
+
+void
+OpticalEdfTest::DoRun()
+{
+	// source - switch - destination
+	NodeContainer nodes;
+	for (int i = 0; i < 3; i++)
+	{
+		Ptr<TimeNode> node = CreateObject<TimeNode>();
+		node->SetAttribute("Skew", DoubleValue(0));
+		nodes.Add(node);
+	}
+	OpticalHelper helper = GetTestHelper(1);
+	helper.SetDeviceAttribute("ControlScheduler", StringValue("Edf"));
+	// AWK and NACK are due well after the reservations
+	helper.SetDeviceAttribute("PacketDelay", TimeValue(MicroSeconds(5)));
+	std::vector<NetDeviceContainer> links;
+	for (int i = 0; i < 2; i++)
+	{
+		links.push_back(helper.Install(nodes.Get(i), nodes.Get(i + 1)));
+	}
+	InternetStackHelper stack;
+	stack.Install(nodes);
+	OpticalAddressHelper address(Ipv4Address("10.0.0.0"), 30);
+	address.Assign(links);
+	NodeContainer ends(nodes.Get(0), nodes.Get(2));
+	helper.SetEndpoints(ends);
+	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	helper.Initialize(nodes);
+
+	m_source = DynamicCast<OpticalDevice>(links[0].Get(0));
+	m_ingress = DynamicCast<OpticalDevice>(links[0].Get(1));
+	m_egress = DynamicCast<OpticalDevice>(links[1].Get(0));
+	m_from = nodes.Get(0)->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
+	m_to = nodes.Get(2)->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
+	m_source->TraceConnectWithoutContext("TxTrace",
+		MakeCallback(&OpticalEdfTest::TxSink, this));
+	m_source->TraceConnectWithoutContext("RxTrace",
+		MakeCallback(&OpticalEdfTest::RxSink, this));
+
+	Simulator::Schedule(MicroSeconds(1), &OpticalEdfTest::QueueEndpoint, 
+						this);
+	// Inside the usable part of a later timeslot
+	Simulator::Schedule(MicroSeconds(54), &OpticalEdfTest::QueueSwitch, 
+						this);
+	Simulator::Stop(MicroSeconds(80));
+	Simulator::Run();
+
+	std::vector<uint32_t> order = {1, 5, 4, 2, 3};
+	NS_TEST_ASSERT_MSG_EQ(m_sent.size() >= order.size(), true,
+		"The source did not send every control packet.");
+	for (uint32_t i = 0; i < order.size() && i < m_sent.size(); i++)
+	{
+		NS_TEST_ASSERT_MSG_EQ(m_sent[i], order[i], 
+			"Control packet " << i << " sent out of deadline order.");
+	}
+	NS_TEST_ASSERT_MSG_EQ(m_source->GetLateDropCount(), 1,
+		"The late reservation was not dropped at the source.");
+	NS_TEST_ASSERT_MSG_EQ(m_egress->GetLateDropCount(), 1,
+		"The late reservation was not dropped at the switch.");
+	NS_TEST_ASSERT_MSG_EQ(m_egress->GetSlotOccupancy(m_arrival, 1), 0,
+		"The switch kept the hold of a dropped reservation.");
+	NS_TEST_ASSERT_MSG_EQ(m_ingress->GetSlotOccupancy(m_arrival, 1), 0,
+		"The ingress kept the hold of a dropped reservation.");
+	NS_TEST_ASSERT_MSG_EQ(m_released, true,
+		"The source was not sent a release.");
+	m_source = nullptr;
+	m_ingress = nullptr;
+	m_egress = nullptr;
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for fluid background load in a timeslot
+ */
+class OpticalFluidLoadTest : public TestCase
+{
+  public:
+    OpticalFluidLoadTest();
+    virtual ~OpticalFluidLoadTest();
+  private:
+    void DoRun() override;
+};
+OpticalFluidLoadTest::OpticalFluidLoadTest()
+    : TestCase("Will test burst capacity next to a fluid load."){}
+OpticalFluidLoadTest::~OpticalFluidLoadTest(){}
+
+void
+OpticalFluidLoadTest::DoRun()
+{
+	Ptr<OpticalSlotClock> clock = CreateObject<OpticalSlotClock>();
+	clock->Configure(NanoSeconds(500), MicroSeconds(10), 5, 1, 1);
+	clock->Start(NanoSeconds(0));
+	// A 60% background load leaves room for 4us of bursts
+	clock->SetFluidLoad(0, 1, 0.6);
+	OpticalSlotClock::Slot& slot = clock->Materialise(clock->GetSlotStart(1));
+	NS_TEST_ASSERT_MSG_EQ(clock->HasCapacity(slot, 0, 1, MicroSeconds(4)), 
+		true, "Burst fits next to the load.");
+	NS_TEST_ASSERT_MSG_EQ(clock->HasCapacity(slot, 0, 1, MicroSeconds(5)), 
+		false, "Burst exceeds the free capacity.");
+	NS_TEST_ASSERT_MSG_EQ(clock->HasCapacity(slot, 0, 0, MicroSeconds(5)), 
+		true, "Other channels are not loaded.");
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for the free channel mask of a timeslot
+ */
+class OpticalFreeChannelsTest : public TestCase
+{
+  public:
+    OpticalFreeChannelsTest();
+    virtual ~OpticalFreeChannelsTest();
+  private:
+    void DoRun() override;
+};
+OpticalFreeChannelsTest::OpticalFreeChannelsTest()
+    : TestCase("Will test free channel masks around reserved bursts."){}
+OpticalFreeChannelsTest::~OpticalFreeChannelsTest(){}
+
+void
+OpticalFreeChannelsTest::DoRun()
+{
+	// Channel 2 holds [100, 200] on port 0, channel 3 on port 1
+	OpticalSlotClock::Slot lanes;
+	lanes.Reset(2, 3);
+	lanes.AddBurst(0, 2, 1, 100, 200);
+	lanes.AddBurst(1, 3, 2, 100, 200);
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetFreeChannels(0, 150, 250), 0xa, 
+		"Only channel 2 is taken on port 0.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetFreeChannels(1, 50, 300), 0x6, 
+		"A burst containing a reservation overlaps it.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetFreeChannels(0, 201, 300), 0xe, 
+		"Bursts after a reservation are free.");
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for the flat burst arrays of a timeslot
+ */
+class OpticalSlotLanesTest : public TestCase
+{
+  public:
+    OpticalSlotLanesTest();
+    virtual ~OpticalSlotLanesTest();
+  private:
+    void DoRun() override;
+};
+OpticalSlotLanesTest::OpticalSlotLanesTest()
+    : TestCase("Will test bursts survive growing and removing lanes."){}
+OpticalSlotLanesTest::~OpticalSlotLanesTest(){}
+
+void
+OpticalSlotLanesTest::DoRun()
+{
+	OpticalSlotClock::Slot lanes;
+	lanes.Reset(2, 2);
+	lanes.AddBurst(0, 1, 1, 100, 400);
+	NS_TEST_ASSERT_MSG_EQ(lanes.Overlaps(0, 1, 200, 300), true,
+		"A burst inside a reservation overlaps it.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.Overlaps(0, 1, 200, 300, 1), false,
+		"A message does not overlap itself.");
+
+	// Six bursts on one lane grow the arrays past four per lane
+	lanes.AddBurst(0, 2, 99, 1000, 1100);
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		lanes.AddBurst(1, 2, 10 + i, 100 * i, 100 * i + 50);
+	}
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetNBursts(1, 2), 6, "Wrong burst count.");
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		NS_TEST_ASSERT_MSG_EQ(lanes.GetBurstAt(1, 2, 100 * i + 25), 10 + i,
+			"Burst " << i << " lost its id or arrival.");
+		NS_TEST_ASSERT_MSG_EQ(lanes.GetBurstAt(1, 2, 100 * i + 75), 
+			OpticalSlotClock::Slot::NO_ID, 
+			"Burst " << i << " lost its exit.");
+	}
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetBusyTime(1, 2), 300, 
+		"Wrong busy time after growing.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetBurstAt(0, 1, 250), 1,
+		"Another port lost its burst.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetBurstAt(0, 2, 1050), 99,
+		"Another channel lost its burst.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetNBursts(1, 1), 0,
+		"A burst moved to another lane.");
+
+	// Removing a burst moves the last one into its place
+	NS_TEST_ASSERT_MSG_EQ(lanes.RemoveBurst(1, 2, 11), true,
+		"The burst was not found.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetNBursts(1, 2), 5, "Wrong burst count.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetBurstAt(1, 2, 125), 
+		OpticalSlotClock::Slot::NO_ID, "The removed burst is still held.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.GetBurstAt(1, 2, 525), 15,
+		"The moved burst lost its interval.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.HasBurst(1, 2, 15), true,
+		"The moved burst lost its id.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.Overlaps(1, 2, 540, 560), true,
+		"The moved burst lost its exit.");
+	NS_TEST_ASSERT_MSG_EQ(lanes.Overlaps(1, 2, 551, 599), false,
+		"The moved burst grew.");
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for withdrawing a refused burst
+ */
+class OpticalSlotCancelTest : public TestCase
+{
+  public:
+    OpticalSlotCancelTest();
+    virtual ~OpticalSlotCancelTest();
+  private:
+    void DoRun() override;
+};
+OpticalSlotCancelTest::OpticalSlotCancelTest()
+    : TestCase("Will test cancelling a held reservation."){}
+OpticalSlotCancelTest::~OpticalSlotCancelTest(){}
+
+void
+OpticalSlotCancelTest::DoRun()
+{
+	// A refused burst is withdrawn and its ingress channel unbound
+	Ptr<OpticalSlotClock> paired = CreateObject<OpticalSlotClock>();
+	paired->Configure(NanoSeconds(500), MicroSeconds(10), 5, 2, 1);
+	paired->Start(NanoSeconds(0));
+	Time start = paired->GetSlotStart(1);
+	OpticalSlotClock::Slot& held = paired->Materialise(start);
+	held.SetRoute(0, 1, 1);
+	held.AddBurst(0, 1, 7, start.GetTimeStep(), start.GetTimeStep() + 100);
+	held.AddBurst(1, 1, 7, start.GetTimeStep(), start.GetTimeStep() + 100);
+	NS_TEST_ASSERT_MSG_EQ(paired->Cancel(start, 0, 1, 1, 7), true,
+		"The reservation was held.");
+	NS_TEST_ASSERT_MSG_EQ(held.GetNBursts(1, 1), 0,
+		"The egress burst is removed.");
+	NS_TEST_ASSERT_MSG_EQ(held.GetRoute(0, 1), -1,
+		"The unused ingress channel is unbound.");
+	NS_TEST_ASSERT_MSG_EQ(paired->Cancel(start, 0, 1, 1, 7), false,
+		"A second release finds nothing.");
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for burst reservations without timeslots
+ */
+class OpticalSlotClockTableTest : public TestCase
+{
+  public:
+    OpticalSlotClockTableTest();
+    virtual ~OpticalSlotClockTableTest();
+  private:
+    void DoRun() override;
+};
+OpticalSlotClockTableTest::OpticalSlotClockTableTest()
+    : TestCase("Will test reservations in the unslotted burst table."){}
+OpticalSlotClockTableTest::~OpticalSlotClockTableTest(){}
+
+void
+OpticalSlotClockTableTest::DoRun()
+{
+	// Without slots each burst holds its ports for its own interval
+	Ptr<OpticalSlotClock> table = CreateObject<OpticalSlotClock>();
+	table->SetSlotted(false);
+	table->Configure(NanoSeconds(500), MicroSeconds(10), 5, 3, 1);
+	table->Start(NanoSeconds(0));
+	NS_TEST_ASSERT_MSG_EQ(table->Reserve(NanoSeconds(100), NanoSeconds(300),
+		0, 1, 1, 1, NanoSeconds(0)), true, "The ports are free.");
+	NS_TEST_ASSERT_MSG_EQ(table->Reserve(NanoSeconds(250), NanoSeconds(400),
+		2, 1, 1, 2, NanoSeconds(0)), false, "The egress is held.");
+	NS_TEST_ASSERT_MSG_EQ(table->Reserve(NanoSeconds(301), NanoSeconds(400),
+		2, 1, 1, 2, NanoSeconds(0)), true, "The egress is free again.");
+	NS_TEST_ASSERT_MSG_EQ(table->GetBurstRoute(0, 1, NanoSeconds(200)), 1,
+		"The burst is routed to its egress.");
+	NS_TEST_ASSERT_MSG_EQ(table->GetBurstRoute(1, 1, NanoSeconds(200)), -1,
+		"Nothing enters through the egress.");
+	NS_TEST_ASSERT_MSG_EQ(table->Reserve(NanoSeconds(500), NanoSeconds(600),
+		0, 1, 1, 3, NanoSeconds(450)), true, "Passed bursts are dropped.");
+	NS_TEST_ASSERT_MSG_EQ(table->GetBursts().GetNBursts(1, 1), 1,
+		"Only the new burst is held.");
+	NS_TEST_ASSERT_MSG_EQ(table->GetBursts().GetNBursts(2, 1), 0,
+		"Passed bursts are dropped on the other lanes too.");
+	table->Expire(NanoSeconds(700));
+	NS_TEST_ASSERT_MSG_EQ(table->GetBursts().GetNBursts(0, 1), 0,
+		"Expiring drops bursts without a new reservation.");
+	NS_TEST_ASSERT_MSG_EQ(table->GetBurstRoute(0, 1, NanoSeconds(550)), -1,
+		"An expired burst has no route.");
+
+	// A port with more channels configured after the start still fits
+	Ptr<OpticalSlotClock> wide = CreateObject<OpticalSlotClock>();
+	wide->SetSlotted(false);
+	wide->Configure(NanoSeconds(500), MicroSeconds(10), 5, 2, 1);
+	wide->Start(NanoSeconds(0));
+	wide->Configure(NanoSeconds(500), MicroSeconds(10), 5, 2, 4);
+	NS_TEST_ASSERT_MSG_EQ(wide->GetBursts().GetWidth(), 5, 
+		"The burst table has every channel.");
+	NS_TEST_ASSERT_MSG_EQ(wide->Reserve(NanoSeconds(100), NanoSeconds(300),
+		0, 1, 4, 1, NanoSeconds(0)), true, "The widest channel is held.");
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for channels with more than two devices
+ */
+class OpticalSharedChannelTest : public TestCase
+{
+  public:
+    OpticalSharedChannelTest();
+    virtual ~OpticalSharedChannelTest();
+  private:
+    void DoRun() override;
+};
+OpticalSharedChannelTest::OpticalSharedChannelTest()
+    : TestCase("Will test attaching many devices to one channel."){}
+OpticalSharedChannelTest::~OpticalSharedChannelTest(){}
+
+void
+OpticalSharedChannelTest::DoRun()
+{
+	NodeContainer nodes;
+	for (int i = 0; i < 4; i++)
+	{
+		nodes.Add(CreateObject<TimeNode>());
+	}
+	OpticalHelper helper;
+	NetDeviceContainer pair = helper.Install(nodes.Get(0), nodes.Get(1));
+	Ptr<OpticalChannel> link = 
+		DynamicCast<OpticalChannel>(pair.Get(0)->GetChannel());
+	NS_TEST_ASSERT_MSG_EQ(link->GetDestination(0, 1), 1, 
+		"A link reaches its peer.");
+
+	NetDeviceContainer devs = helper.InstallShared(nodes);
+	Ptr<OpticalChannel> star = 
+		DynamicCast<OpticalChannel>(devs.Get(0)->GetChannel());
+	NS_TEST_ASSERT_MSG_EQ(star->GetNDevices(), 4, "Wrong device count.");
+	for (uint32_t i = 0; i < devs.GetN(); i++)
+	{
+		Ptr<OpticalDevice> dev = DynamicCast<OpticalDevice>(devs.Get(i));
+		NS_TEST_ASSERT_MSG_EQ(star->GetDeviceIndex(dev), i, 
+			"Wrong device index.");
+		NS_TEST_ASSERT_MSG_EQ(dev->IsLinkUp(), true, "Link is down.");
+	}
+	NS_TEST_ASSERT_MSG_EQ(star->GetDestination(2, 1), 
+		OpticalChannel::BROADCAST, "A star reaches every device.");
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for addressed delivery on a shared channel
+ */
+class OpticalSharedDeliveryTest : public TestCase
+{
+  public:
+    OpticalSharedDeliveryTest();
+    virtual ~OpticalSharedDeliveryTest();
+  private:
+    void DoRun() override;
+	void RxCallback(Ptr<Socket> sock);
+	void RxSink(std::string context, Ptr<const Packet> p);
+	void SendFunc();
+	Ptr<Socket> m_tx;
+	Address m_dest;
+	uint32_t m_received;
+	std::map<std::string, uint32_t> m_frames;
+};
+OpticalSharedDeliveryTest::OpticalSharedDeliveryTest()
+    : TestCase("Will test a shared channel only delivers to the addressed "
+			   "device."), m_received(0){}
+OpticalSharedDeliveryTest::~OpticalSharedDeliveryTest(){}
+
+void
+OpticalSharedDeliveryTest::RxCallback(Ptr<Socket> sock)
+{
+	sock->Recv();
+	m_received++;
+}
+
+void
+OpticalSharedDeliveryTest::RxSink(std::string context, Ptr<const Packet> p)
+{
+	m_frames[context]++;
+}
+
+void
+OpticalSharedDeliveryTest::SendFunc()
+{
+	std::string msg = "Hello from node.";
+	m_tx->SendTo(reinterpret_cast<const uint8_t*>(&msg[0]), 16, 0, m_dest);
+}
+
+void
+OpticalSharedDeliveryTest::DoRun()
+{
+	NodeContainer nodes;
+	for (int i = 0; i < 3; i++)
+	{
+		Ptr<TimeNode> node = CreateObject<TimeNode>();
+		node->SetAttribute("Skew", DoubleValue(0));
+		nodes.Add(node);
+	}
+	OpticalHelper helper = GetTestHelper(1);
+	NetDeviceContainer devs = helper.InstallShared(nodes);
+	InternetStackHelper stack;
+	stack.Install(nodes);
+	Ipv4AddressHelper address;
+	address.SetBase(Ipv4Address("10.1.1.0"), Ipv4Mask("255.255.255.0"));
+	address.Assign(devs);
+	helper.SetEndpoints(nodes);
+	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	helper.Initialize(nodes);
+	for (uint32_t i = 0; i < devs.GetN(); i++)
+	{
+		devs.Get(i)->TraceConnect("RxTrace", std::to_string(i),
+			MakeCallback(&OpticalSharedDeliveryTest::RxSink, this));
+	}
+
+	TypeId sock_tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+	Ptr<Node> dest = nodes.Get(1);
+	Ipv4Address addr = dest->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
+	m_dest = InetSocketAddress(addr, 80);
+	Ptr<Socket> rx = Socket::CreateSocket(dest, sock_tid);
+	rx->Bind(m_dest);
+	rx->SetRecvCallback(
+		MakeCallback(&OpticalSharedDeliveryTest::RxCallback, this));
+	m_tx = Socket::CreateSocket(nodes.Get(0), sock_tid);
+	Simulator::Schedule(NanoSeconds(10), &OpticalSharedDeliveryTest::SendFunc,
+						this);
+	Simulator::Stop(MicroSeconds(50));
+	Simulator::Run();
+	NS_TEST_ASSERT_MSG_EQ(m_received, 1, "The message did not arrive once.");
+	NS_TEST_ASSERT_MSG_GT(m_frames["1"], 0, 
+		"The addressed device saw no frames.");
+	NS_TEST_ASSERT_MSG_EQ(m_frames["2"], 0, 
+		"A bystander device received a frame.");
+	m_tx = nullptr;
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for releasing the hops before a refused reservation
+ */
+class OpticalReleaseTest : public TestCase
+{
+  public:
+    OpticalReleaseTest();
+    virtual ~OpticalReleaseTest();
+  private:
+    void DoRun() override;
+	void ReserveSink(Ptr<const Packet> p);
+	void ReleaseSink(Ptr<const Packet> p);
+	void SendFunc();
+	Ptr<Socket> m_tx;
+	Address m_dest;
+	Ptr<OpticalDevice> m_upstream;
+	int m_held;
+	int m_left;
+};
+OpticalReleaseTest::OpticalReleaseTest()
+    : TestCase("Will test a refused burst is released at the hops before."),
+	  m_held(-1), m_left(-1){}
+OpticalReleaseTest::~OpticalReleaseTest(){}
+
+void
+OpticalReleaseTest::ReserveSink(Ptr<const Packet> p)
+{
+	// The first reservation reaching the refusing switch
+	if (m_held < 0)
+	{
+		m_held = m_upstream->GetReservationCount();
+	}
+}
+
+void
+OpticalReleaseTest::ReleaseSink(Ptr<const Packet> p)
+{
+	// The first release reaching the source, before it tries again
+	if (m_left < 0)
+	{
+		m_left = m_upstream->GetReservationCount();
+	}
+}
+
+void
+OpticalReleaseTest::SendFunc()
+{
+	std::string msg = "Hello from node.";
+	m_tx->SendTo(reinterpret_cast<const uint8_t*>(&msg[0]), 16, 0, m_dest);
+}
+
+void
+OpticalReleaseTest::DoRun()
+{
+	// source - first switch - second switch - destination
+	NodeContainer nodes;
+	for (int i = 0; i < 4; i++)
+	{
+		Ptr<TimeNode> node = CreateObject<TimeNode>();
+		node->SetAttribute("Skew", DoubleValue(0));
+		nodes.Add(node);
+	}
+	OpticalHelper helper = GetTestHelper(1);
+	std::vector<NetDeviceContainer> links;
+	for (int i = 0; i < 3; i++)
+	{
+		links.push_back(helper.Install(nodes.Get(i), nodes.Get(i + 1)));
+	}
+	InternetStackHelper stack;
+	stack.Install(nodes);
+	OpticalAddressHelper address(Ipv4Address("10.0.0.0"), 30);
+	address.Assign(links);
+	NodeContainer ends(nodes.Get(0), nodes.Get(3));
+	helper.SetEndpoints(ends);
+	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	helper.Initialize(nodes);
+
+	// The second switch has no room left towards the destination
+	Ptr<NetDevice> full = links[2].Get(0);
+	nodes.Get(2)->GetObject<OpticalSlotClock>()->SetFluidLoad(
+		full->GetIfIndex(), 1, 1.0);
+	m_upstream = DynamicCast<OpticalDevice>(links[1].Get(0));
+	links[1].Get(1)->TraceConnectWithoutContext("RxTrace",
+		MakeCallback(&OpticalReleaseTest::ReserveSink, this));
+	links[0].Get(0)->TraceConnectWithoutContext("RxTrace",
+		MakeCallback(&OpticalReleaseTest::ReleaseSink, this));
+
+	TypeId sock_tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+	Ipv4Address addr = 
+		nodes.Get(3)->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
+	m_dest = InetSocketAddress(addr, 80);
+	m_tx = Socket::CreateSocket(nodes.Get(0), sock_tid);
+	Simulator::Schedule(NanoSeconds(10), &OpticalReleaseTest::SendFunc,
+						this);
+	Simulator::Stop(MicroSeconds(20));
+	Simulator::Run();
+	NS_TEST_ASSERT_MSG_EQ(m_held, 1, 
+		"The first switch did not hold the burst.");
+	NS_TEST_ASSERT_MSG_EQ(m_left, 0, 
+		"The first switch kept the hold of a refused burst.");
+	NS_TEST_ASSERT_MSG_GT(DynamicCast<OpticalDevice>(links[0].Get(0))->
+		GetNackCount(), 0, "The source was not told of the refusal.");
+	m_tx = nullptr;
+	m_upstream = nullptr;
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for picking a channel on links too wide for a channel mask
+ */
+class OpticalWideChannelTest : public TestCase
+{
+  public:
+    OpticalWideChannelTest();
+    virtual ~OpticalWideChannelTest();
+  private:
+    void DoRun() override;
+	void RxCallback(Ptr<Socket> sock);
+	void SendFunc();
+	Ptr<Socket> m_tx;
+	Address m_dest;
+	uint32_t m_received;
+};
+OpticalWideChannelTest::OpticalWideChannelTest()
+    : TestCase("Will test FirstFit falls back to a random pick on 64 "
+			   "channels."), m_received(0){}
+OpticalWideChannelTest::~OpticalWideChannelTest(){}
+
+void
+OpticalWideChannelTest::RxCallback(Ptr<Socket> sock)
+{
+	sock->Recv();
+	m_received++;
+}
+
+void
+OpticalWideChannelTest::SendFunc()
+{
+	std::string msg = "Hello from node.";
+	m_tx->SendTo(reinterpret_cast<const uint8_t*>(&msg[0]), 16, 0, m_dest);
+}
+
+void
+OpticalWideChannelTest::DoRun()
+{
+	// source - switch - destination
+	NodeContainer nodes;
+	for (int i = 0; i < 3; i++)
+	{
+		Ptr<TimeNode> node = CreateObject<TimeNode>();
+		node->SetAttribute("Skew", DoubleValue(0));
+		nodes.Add(node);
+	}
+	OpticalHelper helper = GetTestHelper(64);
+	helper.SetDeviceAttribute("ChannelSelection", 
+		EnumValue(OpticalDevice::FIRST_FIT));
+	std::vector<NetDeviceContainer> links;
+	for (int i = 0; i < 2; i++)
+	{
+		links.push_back(helper.Install(nodes.Get(i), nodes.Get(i + 1)));
+	}
+	InternetStackHelper stack;
+	stack.Install(nodes);
+	OpticalAddressHelper address(Ipv4Address("10.0.0.0"), 30);
+	address.Assign(links);
+	NodeContainer ends(nodes.Get(0), nodes.Get(2));
+	helper.SetEndpoints(ends);
+	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	helper.Initialize(nodes);
+
+	TypeId sock_tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+	Ipv4Address addr = 
+		nodes.Get(2)->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
+	m_dest = InetSocketAddress(addr, 80);
+	Ptr<Socket> rx = Socket::CreateSocket(nodes.Get(2), sock_tid);
+	rx->Bind(m_dest);
+	rx->SetRecvCallback(
+		MakeCallback(&OpticalWideChannelTest::RxCallback, this));
+	m_tx = Socket::CreateSocket(nodes.Get(0), sock_tid);
+	Simulator::Schedule(NanoSeconds(10), &OpticalWideChannelTest::SendFunc,
+						this);
+	Simulator::Stop(MicroSeconds(50));
+	Simulator::Run();
+	NS_TEST_ASSERT_MSG_EQ(m_received, 1, "The message did not arrive once.");
+	m_tx = nullptr;
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for bursts timed by Jet or Jit signalling over two switches
+ */
+class OpticalSignallingTest : public TestCase
+{
+  public:
+    OpticalSignallingTest(OpticalDevice::Signalling signalling, 
+						  std::string name);
+    virtual ~OpticalSignallingTest();
+  private:
+    void DoRun() override;
+	void RxCallback(Ptr<Socket> sock);
+	void TxSink(Ptr<const Packet> p);
+	void ReserveSink(Ptr<const Packet> p);
+	void SendFunc();
+	OpticalDevice::Signalling m_signalling;
+	Ptr<Socket> m_tx;
+	Address m_dest;
+	Ptr<TimeNode> m_switch;
+	uint32_t m_ingress;
+	uint32_t m_received;
+	Time m_control_sent;
+	Time m_control_tx;
+	Time m_data_sent;
+	int m_held;
+};
+OpticalSignallingTest::OpticalSignallingTest(
+	OpticalDevice::Signalling signalling, std::string name)
+    : TestCase("Will test " + name + " bursts cross two switches after "
+			   "their offset."), m_signalling(signalling), m_ingress(0),
+	  m_received(0), m_control_sent(-1), m_data_sent(-1), m_held(-1){}
+OpticalSignallingTest::~OpticalSignallingTest(){}
+
+void
+OpticalSignallingTest::RxCallback(Ptr<Socket> sock)
+{
+	sock->Recv();
+	m_received++;
+}
+
+void
+OpticalSignallingTest::TxSink(Ptr<const Packet> p)
+{
+	OpticalTag tag;
+	p->PeekPacketTag(tag);
+	if (tag.GetChannel() == 0 && m_control_sent.IsNegative())
+	{
+		m_control_sent = Simulator::Now();
+		m_control_tx = DataRate("40Gbps").CalculateBytesTxTime(p->GetSize());
+	}
+	else if (tag.GetChannel() > 0 && m_data_sent.IsNegative())
+	{
+		m_data_sent = Simulator::Now();
+	}
+}
+
+void
+OpticalSignallingTest::ReserveSink(Ptr<const Packet> p)
+{
+	// The first switch has processed the reservation, the burst is a
+	// setup time and more away
+	if (m_held < 0)
+	{
+		Ptr<OpticalSlotClock> clock = m_switch->GetObject<OpticalSlotClock>();
+		uint32_t id = clock->GetBursts().GetBurstAt(m_ingress, 1, 
+			m_switch->GetLocalTime().GetTimeStep());
+		m_held = (id != OpticalSlotClock::Slot::NO_ID) ? 1 : 0;
+	}
+}
+
+void
+OpticalSignallingTest::SendFunc()
+{
+	std::string msg = "Hello from node.";
+	m_tx->SendTo(reinterpret_cast<const uint8_t*>(&msg[0]), 16, 0, m_dest);
+}
+
+void
+OpticalSignallingTest::DoRun()
+{
+	// source - first switch - second switch - destination
+	NodeContainer nodes;
+	for (int i = 0; i < 4; i++)
+	{
+		Ptr<TimeNode> node = CreateObject<TimeNode>();
+		node->SetAttribute("Skew", DoubleValue(0));
+		nodes.Add(node);
+	}
+	OpticalHelper helper = GetTestHelper(1);
+	helper.SetDeviceAttribute("Signalling", EnumValue(m_signalling));
+	std::vector<NetDeviceContainer> links;
+	for (int i = 0; i < 3; i++)
+	{
+		links.push_back(helper.Install(nodes.Get(i), nodes.Get(i + 1)));
+	}
+	InternetStackHelper stack;
+	stack.Install(nodes);
+	OpticalAddressHelper address(Ipv4Address("10.0.0.0"), 30);
+	address.Assign(links);
+	NodeContainer ends(nodes.Get(0), nodes.Get(3));
+	helper.SetEndpoints(ends);
+	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	helper.Initialize(nodes);
+
+	m_switch = DynamicCast<TimeNode>(nodes.Get(1));
+	m_ingress = links[0].Get(1)->GetIfIndex();
+	links[0].Get(0)->TraceConnectWithoutContext("TxTrace",
+		MakeCallback(&OpticalSignallingTest::TxSink, this));
+	links[1].Get(1)->TraceConnectWithoutContext("RxTrace",
+		MakeCallback(&OpticalSignallingTest::ReserveSink, this));
+
+	TypeId sock_tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+	Ipv4Address addr = 
+		nodes.Get(3)->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
+	m_dest = InetSocketAddress(addr, 80);
+	Ptr<Socket> rx = Socket::CreateSocket(nodes.Get(3), sock_tid);
+	rx->Bind(m_dest);
+	rx->SetRecvCallback(
+		MakeCallback(&OpticalSignallingTest::RxCallback, this));
+	m_tx = Socket::CreateSocket(nodes.Get(0), sock_tid);
+	Simulator::Schedule(NanoSeconds(10), &OpticalSignallingTest::SendFunc,
+						this);
+	Simulator::Stop(MicroSeconds(20));
+	Simulator::Run();
+	NS_TEST_ASSERT_MSG_EQ(m_received, 1, "The message did not arrive once.");
+	// The reservation falls behind at both switches, then the last one
+	// sets up, instead of waiting a PacketDelay
+	Time offset = NanoSeconds(350) + (NanoSeconds(350) + m_control_tx + 
+		NanoSeconds(50)) * 2 + NanoSeconds(500);
+	NS_TEST_ASSERT_MSG_EQ(m_data_sent - m_control_sent, offset,
+		"The burst did not leave after the offset of its path.");
+	NS_TEST_ASSERT_MSG_EQ(m_held, (m_signalling == OpticalDevice::JIT) ? 1 : 0,
+		"The ports were held from the wrong time.");
+	m_tx = nullptr;
+	m_switch = nullptr;
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for the AWGR routing table
+ */
+class OpticalAwgrTest : public TestCase
+{
+  public:
+    OpticalAwgrTest();
+    virtual ~OpticalAwgrTest();
+  private:
+    void DoRun() override;
+};
+OpticalAwgrTest::OpticalAwgrTest()
+    : TestCase("Will test routing by port and wavelength in an AWGR."){}
+OpticalAwgrTest::~OpticalAwgrTest(){}
+
+void
+OpticalAwgrTest::DoRun()
+{
+	Ptr<TimeNode> sw = CreateObject<TimeNode>();
+	OpticalHelper helper;
+	helper.SetChannelAttribute("NumChannels", UintegerValue(4));
+	for (int i = 0; i < 3; i++)
+	{
+		helper.Install(sw, CreateObject<TimeNode>());
+	}
+	helper.InstallAwgr(NodeContainer(sw));
+	Ptr<OpticalAwgr> awgr = sw->GetObject<OpticalAwgr>();
+	awgr->Build(sw);
+	NS_TEST_ASSERT_MSG_EQ(awgr->GetNPorts(), 3, "Wrong port count.");
+	NS_TEST_ASSERT_MSG_EQ(awgr->GetRoute(0, 1), 1, "Port 0 channel 1.");
+	NS_TEST_ASSERT_MSG_EQ(awgr->GetRoute(2, 2), 1, "Port 2 channel 2.");
+	NS_TEST_ASSERT_MSG_EQ(awgr->GetRoute(1, 3), -1, 
+		"A port does not route to itself.");
+	NS_TEST_ASSERT_MSG_EQ(awgr->GetRoute(1, 0), -1, 
+		"The control channel is not switched.");
+	NS_TEST_ASSERT_MSG_EQ(awgr->GetRoute(1, 5), -1, "Channel out of range.");
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for delivery across an AWGR fat-tree core
+ */
+class OpticalAwgrFatTreeTest : public TestCase
+{
+  public:
+    OpticalAwgrFatTreeTest();
+    virtual ~OpticalAwgrFatTreeTest();
+  private:
+    void DoRun() override;
+	void RxCallback(Ptr<Socket> sock);
+	void SendFunc();
+	Ptr<Socket> m_tx;
+	Address m_dest;
+	uint32_t m_received;
+};
+OpticalAwgrFatTreeTest::OpticalAwgrFatTreeTest()
+    : TestCase("Will test bursts cross a fat-tree with an AWGR core."),
+	  m_received(0){}
+OpticalAwgrFatTreeTest::~OpticalAwgrFatTreeTest(){}
+
+void
+OpticalAwgrFatTreeTest::RxCallback(Ptr<Socket> sock)
+{
+	sock->Recv();
+	m_received++;
+}
+
+void
+OpticalAwgrFatTreeTest::SendFunc()
+{
+	std::string msg = "Hello from node.";
+	m_tx->SendTo(reinterpret_cast<const uint8_t*>(&msg[0]), 16, 0, m_dest);
+}
+
+void
+OpticalAwgrFatTreeTest::DoRun()
+{
+	// One endpoint per cluster, so every message crosses the core
+	FatTreeHelper fat_tree;
+	fat_tree.GetOpticalHelper() = GetTestHelper(2);
+	fat_tree.SetClustered(1, 1, 2);
+	fat_tree.SetDeriveTiming(true);
+	fat_tree.SetAwgr(true);
+	fat_tree.Install();
+	fat_tree.PopulateRoutingTables();
+	Ptr<Node> core = fat_tree.GetLayer3().Get(0);
+	Ptr<Node> edge = fat_tree.GetLayer1().Get(0);
+	NS_TEST_ASSERT_MSG_NE(core->GetObject<OpticalAwgr>(), nullptr, 
+		"The core is not a grating.");
+	NS_TEST_ASSERT_MSG_EQ(edge->GetObject<OpticalAwgr>(), nullptr, 
+		"Only the core is a grating.");
+
+	TypeId sock_tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+	NodeContainer endpoints = fat_tree.GetEndpoints();
+	m_dest = InetSocketAddress(
+		fat_tree.GetEndpointInterfaces().GetAddress(1), 80);
+	Ptr<Socket> rx = Socket::CreateSocket(endpoints.Get(1), sock_tid);
+	rx->Bind(m_dest);
+	rx->SetRecvCallback(
+		MakeCallback(&OpticalAwgrFatTreeTest::RxCallback, this));
+	m_tx = Socket::CreateSocket(endpoints.Get(0), sock_tid);
+	Simulator::Schedule(NanoSeconds(10), &OpticalAwgrFatTreeTest::SendFunc,
+						this);
+	Simulator::Stop(MicroSeconds(100));
+	Simulator::Run();
+	NS_TEST_ASSERT_MSG_EQ(m_received, 1, 
+		"The message did not cross the grating.");
+	m_tx = nullptr;
+	Simulator::Destroy();
+}
+
+/**
+ * @ingroup quantum-network-tests
+ * Test case for bulk link addressing
+ */
+class OpticalAddressHelperTest : public TestCase
+{
+  public:
+    OpticalAddressHelperTest();
+    virtual ~OpticalAddressHelperTest();
+  private:
+    void DoRun() override;
+};
+OpticalAddressHelperTest::OpticalAddressHelperTest()
+    : TestCase("Will test /30 link address allocation."){}
+OpticalAddressHelperTest::~OpticalAddressHelperTest(){}
+
+void
+OpticalAddressHelperTest::DoRun()
+{
+	NodeContainer nodes;
+	for (int i = 0; i < 3; i++)
+	{
+		nodes.Add(CreateObject<TimeNode>());
+	}
+	OpticalHelper helper;
+	std::vector<NetDeviceContainer> links;
+	links.push_back(helper.Install(nodes.Get(0), nodes.Get(1)));
+	links.push_back(helper.Install(nodes.Get(2), nodes.Get(1)));
+	InternetStackHelper stack;
+	stack.Install(nodes);
+
+	OpticalAddressHelper address(Ipv4Address("10.0.0.0"), 30);
+	Ipv4InterfaceContainer interfaces = address.Assign(links);
+	NS_TEST_ASSERT_MSG_EQ(interfaces.GetN(), 4, "Wrong interface count.");
+	NS_TEST_ASSERT_MSG_EQ(interfaces.GetAddress(0), Ipv4Address("10.0.0.1"),
+		"First link, first device.");
+	NS_TEST_ASSERT_MSG_EQ(interfaces.GetAddress(1), Ipv4Address("10.0.0.2"),
+		"First link, second device.");
+	NS_TEST_ASSERT_MSG_EQ(interfaces.GetAddress(2), Ipv4Address("10.0.0.5"),
+		"Second link, first device.");
+	NS_TEST_ASSERT_MSG_EQ(interfaces.GetAddress(3), Ipv4Address("10.0.0.6"),
+		"Second link, second device.");
+	NS_TEST_ASSERT_MSG_EQ(address.GetNAllocated(), 2, "Wrong subnet count.");
+
+	address.AlignTo(4);
+	NS_TEST_ASSERT_MSG_EQ(address.GetNextNetwork(), Ipv4Address("10.0.0.16"),
+		"AlignTo did not skip to the next block.");
+	Simulator::Destroy();
+}
+
 /**
  * @ingroup quantum-network-tests
  * TestSuite for module quantum-network
@@ -724,6 +2061,27 @@ QuantumNetworkTestSuite::QuantumNetworkTestSuite()
     AddTestCase(new OpticalDeviceQueueTest(), TestCase::Duration::QUICK);
     AddTestCase(new OpticalDeviceCollisionTest(), TestCase::Duration::QUICK);
     AddTestCase(new OpticalDeviceRouteTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalDeviceIdleTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalFastForwardTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalSlotClockTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalTransmitTimeTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalEdfTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalFluidLoadTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalFreeChannelsTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalSlotLanesTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalSlotCancelTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalSlotClockTableTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalSharedChannelTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalSharedDeliveryTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalReleaseTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalWideChannelTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalSignallingTest(OpticalDevice::JET, "Jet"), 
+                TestCase::Duration::QUICK);
+    AddTestCase(new OpticalSignallingTest(OpticalDevice::JIT, "Jit"), 
+                TestCase::Duration::QUICK);
+    AddTestCase(new OpticalAwgrTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalAwgrFatTreeTest(), TestCase::Duration::QUICK);
+    AddTestCase(new OpticalAddressHelperTest(), TestCase::Duration::QUICK);
 }
 /**
  * @ingroup quantum-network-tests